@@ -0,0 +1,132 @@
+/* auditdump.c
+ *
+ * Décode les fichiers du journal d'audit du serveur (serveur --audit CHEMIN) :
+ * une ligne par événement (création, prise en charge, clôture, escalade, avis,
+ * événements perdus), dans l'ordre du fichier, date locale à la microseconde.
+ *
+ * Format (voir serveur.c) : "TKAUDIT1" puis des enregistrements
+ *   int64 date (ns depuis l'epoch) | uint32 ticket | uint8 type | uint8 longueur du nom
+ *   | 3 notes (avis seulement) | nom
+ */
+
+#define _GNU_SOURCE              // Fonctions POSIX modernes + getopt_long
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+#define AUDIT_MAGIC "TKAUDIT1"
+#define MAX_USER 64
+
+// Types d'événements (mêmes valeurs que audit_type_t dans serveur.c)
+typedef enum {
+    AUDIT_CREATE = 1, AUDIT_ASSIGN, AUDIT_CLOSE, AUDIT_ESCALATE, AUDIT_FEEDBACK, AUDIT_LOST
+} audit_type_t;
+
+static const char *type_names[] = { "?", "CREATE", "ASSIGN", "CLOSE", "ESCALATE", "FEEDBACK", "LOST" };
+
+static uint32_t g_ticket = 0;       // --ticket : seulement les événements de ce ticket (0 = tous)
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [--ticket ID] FICHIER...\n"
+        "  --ticket ID   n'affiche que les événements de ce ticket\n"
+        "Exemple : %s tickets.audit.0.*\n", prog, prog);
+}
+
+// Affiche un événement décodé
+static void print_event(int64_t time_ns, uint32_t ticket, uint8_t type, const uint8_t *notes, const char *name) {
+    time_t secs = (time_t)(time_ns / 1000000000);
+    struct tm tm;
+    char timebuf[64];
+
+    localtime_r(&secs, &tm);
+    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("%s.%06d  %-9s", timebuf, (int)(time_ns % 1000000000 / 1000),
+           type <= AUDIT_LOST ? type_names[type] : type_names[0]);
+    switch (type) {
+        case AUDIT_CREATE:   printf("ticket %u créé par %s\n", ticket, name); break;
+        case AUDIT_ASSIGN:   printf("ticket %u pris en charge par %s\n", ticket, name); break;
+        case AUDIT_CLOSE:    printf("ticket %u clos par %s\n", ticket, name[0] ? name : "-"); break;
+        case AUDIT_ESCALATE: printf("ticket %u passé PRIORITY\n", ticket); break;
+        case AUDIT_FEEDBACK:
+            printf("avis de %s : réactivité %u, compétence %u, satisfaction %u\n",
+                   name, notes[0], notes[1], notes[2]);
+            break;
+        case AUDIT_LOST:     printf("%u événement(s) perdu(s), anneau d'un thread plein\n", ticket); break;
+        default:             printf("type %u inconnu (ticket %u, %s)\n", type, ticket, name); break;
+    }
+}
+
+// Décode un fichier ; retourne -1 s'il n'est pas lisible ou n'est pas un fichier d'audit
+static int dump_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    char magic[8];
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, AUDIT_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s : pas un fichier d'audit\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    while (1) {
+        uint8_t head[14], notes[3] = { 0, 0, 0 };
+        char name[MAX_USER + 1];
+        int64_t time_ns;
+        uint32_t ticket;
+
+        size_t n = fread(head, 1, sizeof(head), fp);
+        if (n == 0) break;
+        memcpy(&time_ns, head, 8);
+        memcpy(&ticket, head + 8, 4);
+        uint8_t type = head[12], name_len = head[13];
+        // Fin coupée : le serveur écrivait ce lot au moment de la copie (ou s'est arrêté)
+        if (n != sizeof(head) ||
+            (type == AUDIT_FEEDBACK && fread(notes, 1, 3, fp) != 3) ||
+            name_len > MAX_USER || fread(name, 1, name_len, fp) != name_len) {
+            fprintf(stderr, "%s : dernier enregistrement incomplet\n", path);
+            break;
+        }
+        name[name_len] = '\0';
+        if (g_ticket == 0 || (ticket == g_ticket && type != AUDIT_FEEDBACK && type != AUDIT_LOST))
+            print_event(time_ns, ticket, type, notes, name);
+    }
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"ticket", required_argument, NULL, 'T'},
+        {"help",   no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int c, rc = EXIT_SUCCESS;
+
+    while ((c = getopt_long(argc, argv, "h", opts, NULL)) != -1) {
+        switch (c) {
+            case 'T':
+                g_ticket = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    for (int i = optind; i < argc; i++)
+        if (dump_file(argv[i]) != 0) rc = EXIT_FAILURE;
+    return rc;
+}
@@ -1,4 +1,16 @@
-#define _POSIX_C_SOURCE 200809L
+/* client.c
+ *
+ * Client du serveur de ticketing :
+ * - mode interactif : une commande par ligne tapée, réponses affichées à leur arrivée
+ * - mode script (--script FICHIER, ou entrée standard redirigée) : toutes les commandes
+ *   sont envoyées d'affilée sans attendre les réponses, lues par un second thread ;
+ *   la durée totale est affichée à la fin
+ *
+ * La connexion passe en FRAMING on : chaque réponse se termine par une ligne ".", ce qui
+ * permet de savoir où elle s'arrête même si elle arrive en plusieurs morceaux.
+ */
+
+#define _GNU_SOURCE              // getline + getopt_long
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,12 +18,24 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <signal.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <inttypes.h>
 
 #define BUFSIZE 2048
 #define DEFAULT_HOST "127.0.0.1"
 #define DEFAULT_PORT 12345
+#define SEND_BUF 65536              // Commandes regroupées par envoi (mode script)
 
 static int sock = -1;
+static int g_script = 0;            // Mode script : pas d'invite
+
+// Avancement de la lecture des réponses (thread lecteur)
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t g_frames = 0;       // Réponses complètes reçues (la première : FRAMING on)
+static int g_closed = 0;            // Connexion fermée par le serveur
 
 // Fermeture propre sur Ctrl+C
 void handle_sigint(int sig) {
@@ -21,23 +45,220 @@ void handle_sigint(int sig) {
     exit(EXIT_SUCCESS);
 }
 
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Envoie tout le tampon (le noyau peut n'en prendre qu'une partie)
+// Retourne -1 si la connexion est coupée
+static int send_all(const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sock, buf, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Fin d'une réponse : la première (FRAMING on) n'est pas affichée ; en mode interactif,
+// l'invite suit chaque réponse
+static void frame_done(void) {
+    pthread_mutex_lock(&g_lock);
+    g_frames++;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+    if (!g_script) {
+        printf("> ");
+        fflush(stdout);
+    }
+}
+
+// Thread lecteur : recopie les réponses sur la sortie standard en retirant la ligne "."
+// de fin et le "." doublé en tête des lignes qui en commencent un
+static void *reader_thread(void *arg) {
+    char in[BUFSIZE], out[BUFSIZE];
+    int bol = 1;                    // En début de ligne
+    int dot = 0;                    // "." lu en début de ligne, en attente du caractère suivant
+    (void)arg;
+
+    while (1) {
+        ssize_t n = recv(sock, in, sizeof(in), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        size_t len = 0;
+        for (ssize_t i = 0; i < n; i++) {
+            char c = in[i];
+            if (dot) {
+                dot = 0;
+                if (c == '\n') {
+                    // Ligne "." : fin de la réponse
+                    if (g_frames > 0) fwrite(out, 1, len, stdout);
+                    len = 0;
+                    bol = 1;
+                    frame_done();
+                    continue;
+                }
+                // Sinon le "." lu était le doublement : on le retire
+            } else if (bol && c == '.') {
+                dot = 1;
+                bol = 0;
+                continue;
+            }
+            out[len++] = c;
+            bol = c == '\n';
+        }
+        if (g_frames > 0) fwrite(out, 1, len, stdout);
+        if (!g_script) fflush(stdout);
+    }
+
+    fflush(stdout);
+    pthread_mutex_lock(&g_lock);
+    g_closed = 1;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_lock);
+    if (!g_script) {
+        printf("\nServeur déconnecté.\n");
+        exit(EXIT_SUCCESS);
+    }
+    return NULL;
+}
+
+// Mode interactif : chaque ligne tapée est envoyée, le thread lecteur affiche les réponses
+static int run_interactive(void) {
+    char sendbuf[BUFSIZE];
+
+    while (fgets(sendbuf, sizeof(sendbuf), stdin)) {
+        if (send_all(sendbuf, strlen(sendbuf)) < 0) {
+            perror("Erreur envoi");
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS; // EOF
+}
+
+// Mode script : envoie toutes les commandes du fichier (lignes vides et commentaires "#"
+// ignorés), puis ferme le sens client -> serveur ; le serveur exécute tout ce qu'il a reçu,
+// envoie les réponses et ferme à son tour la connexion, qui marque la fin des réponses
+static int run_script(FILE *in) {
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    char *buf = malloc(SEND_BUF);
+    size_t len = 0;
+    uint64_t commands = 0;
+    int rc = EXIT_SUCCESS;
+    double t0 = now_s();
+
+    if (!buf) {
+        perror("Erreur d'allocation");
+        return EXIT_FAILURE;
+    }
+    while ((n = getline(&line, &cap, in)) != -1) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (n == 0 || line[0] == '#') continue;
+        commands++;
+
+        if (len > 0 && len + (size_t)n + 1 > SEND_BUF) {
+            if (send_all(buf, len) < 0) break;
+            len = 0;
+        }
+        // Ligne plus longue que le tampon : envoyée seule (le serveur la refusera)
+        if ((size_t)n + 1 > SEND_BUF) {
+            line[n] = '\n';
+            if (send_all(line, (size_t)n + 1) < 0) break;
+            continue;
+        }
+        memcpy(buf + len, line, (size_t)n);
+        buf[len + (size_t)n] = '\n';
+        len += (size_t)n + 1;
+    }
+    // Envoi interrompu : le serveur a fermé la connexion (exit), le lecteur le verra
+    if (n != -1 || (len > 0 && send_all(buf, len) < 0)) {
+        perror("Erreur envoi");
+        rc = EXIT_FAILURE;
+    }
+    free(buf);
+    free(line);
+    shutdown(sock, SHUT_WR);
+
+    // Attente de la fermeture par le serveur, après sa dernière réponse
+    pthread_mutex_lock(&g_lock);
+    while (!g_closed)
+        pthread_cond_wait(&g_cond, &g_lock);
+    uint64_t frames = g_frames > 0 ? g_frames - 1 : 0; // Sans celle de FRAMING on
+    pthread_mutex_unlock(&g_lock);
+    fflush(stdout);
+
+    double elapsed = now_s() - t0;
+    fprintf(stderr, "%" PRIu64 " ligne(s) envoyée(s), %" PRIu64 " réponse(s) en %.3f s (%.0f lignes/s)\n",
+            commands, frames, elapsed, elapsed > 0 ? commands / elapsed : 0.0);
+    return rc;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [--script FICHIER] [IP [PORT]]\n"
+        "  --script FICHIER  envoie les commandes du fichier sans attendre les réponses,\n"
+        "                    puis affiche la durée totale (- = entrée standard) ;\n"
+        "                    implicite quand l'entrée standard n'est pas un terminal\n",
+        prog);
+}
+
 // Fonction principale
 int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"script", required_argument, NULL, 's'},
+        {"help",   no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
     struct sockaddr_in addr = {0};
     const char *host = DEFAULT_HOST;
+    const char *script = NULL;
     int port = DEFAULT_PORT;
+    int c;
 
-    if (argc >= 2) host = argv[1];
-    if (argc >= 3) {
+    while ((c = getopt_long(argc, argv, "s:h", opts, NULL)) != -1) {
+        switch (c) {
+            case 's':
+                script = optarg;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind < argc) host = argv[optind];
+    if (optind + 1 < argc) {
         char *end = NULL;
-        long val = strtol(argv[2], &end, 10);
+        long val = strtol(argv[optind + 1], &end, 10);
         if (*end != '\0' || val <= 0 || val > 65535) {
-            fprintf(stderr, "Port invalide : %s\n", argv[2]);
+            fprintf(stderr, "Port invalide : %s\n", argv[optind + 1]);
             return EXIT_FAILURE;
         }
         port = (int)val;
     }
 
+    // Commandes lues dans un fichier ou dans un tube : mode script
+    FILE *in = stdin;
+    if (script && strcmp(script, "-") != 0) {
+        in = fopen(script, "r");
+        if (!in) {
+            fprintf(stderr, "Impossible d'ouvrir %s : %s\n", script, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    g_script = script != NULL || !isatty(STDIN_FILENO);
+
     signal(SIGINT, handle_sigint); // Gestion Ctrl+C
 
     // Création du socket
@@ -62,42 +283,31 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    // Connexion réussie
-    printf("Connecté à %s:%d\n", host, port);
+    // Connexion réussie (en mode script, la sortie standard ne porte que les réponses)
+    if (!g_script) printf("Connecté à %s:%d\n", host, port);
 
-    char sendbuf[BUFSIZE];
+    // Lecture du message de bienvenue, qui n'est pas délimité
     char recvbuf[BUFSIZE];
-
-    // Lecture du message de bienvenue
     ssize_t n = recv(sock, recvbuf, sizeof(recvbuf) - 1, 0);
-    if (n > 0) {
+    if (n > 0 && !g_script) {
         recvbuf[n] = '\0';
         printf("%s", recvbuf);
     }
 
-    // Boucle principale
-    while (1) {
-        printf("> ");
-        fflush(stdout);
-
-        if (!fgets(sendbuf, sizeof(sendbuf), stdin))
-            break;  // EOF
-
-        if (send(sock, sendbuf, strlen(sendbuf), 0) < 0) {
-            perror("Erreur envoi");
-            break;  // Quitte en cas d'erreur d'envoi
-        }
-
-        n = recv(sock, recvbuf, sizeof(recvbuf) - 1, 0);
-        if (n <= 0) {
-            printf("Serveur déconnecté.\n");
-            break;  // Quitte en cas de déconnexion
-        }
-
-        recvbuf[n] = '\0';
-        printf("%s", recvbuf);
+    pthread_t reader;
+    if (send_all("FRAMING on\n", 11) < 0) {
+        perror("Erreur envoi");
+        close(sock);
+        return EXIT_FAILURE;
+    }
+    if (pthread_create(&reader, NULL, reader_thread, NULL) != 0) {
+        perror("Erreur lors de la création du thread lecteur");
+        close(sock);
+        return EXIT_FAILURE;
     }
 
+    int rc = g_script ? run_script(in) : run_interactive();
+    if (in != stdin) fclose(in);
     close(sock);
-    return EXIT_SUCCESS;
+    return rc;
 }
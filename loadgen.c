@@ -0,0 +1,576 @@
+/* loadgen.c
+ *
+ * Générateur de charge pour le serveur de ticketing :
+ * - N connexions simultanées, réparties entre utilisateurs et techniciens
+ * - mélange de commandes configurable (sendTicket -new, sendTicket -l, list, take, close, exit)
+ * - débit cible global (ou au plus vite), réparti sur un petit nombre de threads epoll
+ * - latence par commande dans des histogrammes log-linéaires (style HDR) : p50/p99/p999
+ *
+ * Les connexions passent en FRAMING on : chaque réponse se termine par une ligne ".",
+ * ce qui permet de mesurer chaque commande sans connaître le texte des réponses.
+ */
+
+#define _GNU_SOURCE              // Fonctions POSIX modernes + getopt_long
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>  // Pour TCP_NODELAY
+
+#define DEFAULT_HOST "127.0.0.1"
+#define DEFAULT_PORT 12345
+#define DEFAULT_CONNECTIONS 64
+#define DEFAULT_THREADS 4
+#define DEFAULT_DURATION 10         // Secondes de mesure
+#define DEFAULT_LIST_LIMIT 20       // --limit des listings (0 = listing complet)
+#define MAX_CONNECTIONS 65536
+#define MAX_THREADS 256
+#define IN_BUF 8192                 // Ligne de réponse la plus longue gardée en entier
+#define MAX_TAKEN 8                 // Tickets pris par un technicien et pas encore clos
+#define TAKE_WINDOW 1000            // take vise un des TAKE_WINDOW derniers tickets créés
+#define MAX_EVENTS 64
+#define CREATED_PREFIX "Ticket créé avec ID "
+
+// Histogramme : valeurs exactes sous 2*HIST_SUB ns, puis HIST_SUB cases par puissance de 2
+// (précision relative 1/HIST_SUB, comme un HdrHistogram à 2 chiffres significatifs)
+#define HIST_SUB_BITS 6
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB + 2 * HIST_SUB)
+
+// Commandes mesurées
+typedef enum {
+    OP_IDENT = 0,                   // Connexion + FRAMING on + IDENT
+    OP_NEW,                         // sendTicket -new (utilisateur)
+    OP_MYLIST,                      // sendTicket -l (utilisateur)
+    OP_EXIT,                        // exit + questionnaire, puis reconnexion
+    OP_LIST,                        // list (technicien)
+    OP_TAKE,                        // take <id> (technicien)
+    OP_CLOSE,                       // close <id> (technicien)
+    OP_COUNT
+} op_t;
+
+static const char *op_names[OP_COUNT] = {
+    "IDENT", "sendTicket -new", "sendTicket -l", "exit", "list", "take", "close"
+};
+
+// Noms acceptés par --mix et poids par défaut
+static const char *op_keys[OP_COUNT] = { "ident", "new", "mylist", "exit", "list", "take", "close" };
+static int g_mix[OP_COUNT] = { 0, 40, 15, 5, 15, 15, 10 };
+
+// Configuration issue de la ligne de commande
+typedef struct {
+    const char *host;
+    int port;
+    int connections;                // Connexions simultanées
+    int techs;                      // Dont techniciens (-1 = un quart)
+    int threads;                    // Threads epoll
+    int duration;                   // Secondes
+    double rate;                    // Requêtes par seconde au total (0 = au plus vite)
+    int list_limit;
+} loadgen_config_t;
+
+static loadgen_config_t g_cfg = { DEFAULT_HOST, DEFAULT_PORT, DEFAULT_CONNECTIONS, -1,
+                                  DEFAULT_THREADS, DEFAULT_DURATION, 0, DEFAULT_LIST_LIMIT };
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} histogram_t;
+
+// État d'une connexion
+typedef enum { PH_HANDSHAKE = 0, PH_IDLE, PH_WAIT } phase_t;
+
+typedef struct {
+    int fd;
+    int tech;                       // Rôle technicien
+    int num;                        // Numéro (nom lg-user-N ou lg-tech-N)
+    phase_t phase;
+    op_t op;                        // Commande en cours
+    int frames_left;                // Réponses encore attendues pour la commande
+    uint64_t start;                 // Instant prévu de la commande (ns)
+    uint64_t next;                  // Prochain envoi prévu (ns)
+    uint64_t interval;              // Écart entre deux commandes (0 = au plus vite)
+    uint32_t target;                // ID visé par take/close
+    uint32_t taken[MAX_TAKEN];      // Tickets pris pas encore clos
+    int ntaken;
+    unsigned seed;
+    size_t inlen;
+    char in[IN_BUF];                // Ligne de réponse en cours de réception
+} conn_t;
+
+// Un thread de charge : ses connexions, son instance epoll et ses mesures
+typedef struct {
+    pthread_t tid;
+    int epfd;
+    conn_t *conns;
+    int nconns;
+    histogram_t hist[OP_COUNT];
+    uint64_t errors;                // Déconnexions inattendues, envois échoués
+} worker_t;
+
+static struct sockaddr_in g_addr;
+static volatile int g_stop = 0;
+static uint64_t g_done = 0;         // Commandes terminées, tous threads (atomique)
+static uint32_t g_last_id = 0;      // Plus grand ID de ticket créé vu (atomique)
+
+// --- Fonction utilitaire pour quitter avec message d’erreur ---
+static void perror_exit(const char *msg){
+    perror(msg);
+    exit(EXIT_FAILURE);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* -------------------
+ * Histogrammes
+ * ------------------- */
+
+static int hist_index(uint64_t v) {
+    int msb = v ? 63 - __builtin_clzll(v) : 0;
+    int shift = msb > HIST_SUB_BITS ? msb - HIST_SUB_BITS : 0;
+    return shift * HIST_SUB + (int)(v >> shift);
+}
+
+// Plus grande valeur rangée dans la case idx
+static uint64_t hist_value(int idx) {
+    if (idx < 2 * HIST_SUB) return (uint64_t)idx;
+    int shift = idx / HIST_SUB - 1;
+    uint64_t top = (uint64_t)(idx - shift * HIST_SUB);
+    return ((top + 1) << shift) - 1;
+}
+
+static void hist_record(histogram_t *h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    h->total++;
+    if (v > h->max) h->max = v;
+}
+
+static void hist_merge(histogram_t *dst, const histogram_t *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+// Valeur sous laquelle se trouvent q (0..1) des mesures
+static uint64_t hist_percentile(const histogram_t *h, double q) {
+    uint64_t rank = (uint64_t)(q * (double)h->total + 0.5), seen = 0;
+    if (rank == 0) rank = 1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) return hist_value(i) < h->max ? hist_value(i) : h->max;
+    }
+    return h->max;
+}
+
+/* -------------------
+ * Connexions
+ * ------------------- */
+
+// Ouvre la connexion et envoie FRAMING on + IDENT ; les deux réponses délimitées
+// terminent la mesure OP_IDENT (la bannière d'accueil n'est pas délimitée)
+// Retourne -1 si la connexion échoue
+static int conn_open(worker_t *w, conn_t *c, uint64_t now) {
+    char buf[128];
+    int one = 1;
+
+    c->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (c->fd < 0) return -1;
+    if (connect(c->fd, (struct sockaddr*)&g_addr, sizeof(g_addr)) < 0) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, c->fd, &ev) < 0) perror_exit("Erreur epoll_ctl");
+
+    int len = snprintf(buf, sizeof(buf), "FRAMING on\nIDENT lg-%s-%d %s\n",
+                       c->tech ? "tech" : "user", c->num, c->tech ? "tech" : "user");
+    c->inlen = 0;
+    c->ntaken = 0;
+    c->phase = PH_HANDSHAKE;
+    c->op = OP_IDENT;
+    c->frames_left = 2;
+    c->start = now;
+    if (send(c->fd, buf, (size_t)len, MSG_NOSIGNAL) != len) return -1;
+    return 0;
+}
+
+static void conn_close(conn_t *c) {
+    if (c->fd >= 0) close(c->fd); // Retire aussi le socket de l'instance epoll
+    c->fd = -1;
+}
+
+// Ferme puis rouvre la connexion (après exit ou une erreur)
+static void conn_reopen(worker_t *w, conn_t *c) {
+    conn_close(c);
+    while (!g_stop && conn_open(w, c, now_ns()) != 0) {
+        w->errors++;
+        conn_close(c);
+        usleep(10000);
+    }
+}
+
+// Tire la prochaine commande selon les poids du rôle
+static op_t conn_pick(conn_t *c) {
+    int first = c->tech ? OP_LIST : OP_NEW, last = c->tech ? OP_CLOSE : OP_EXIT;
+    int total = 0;
+
+    for (int op = first; op <= last; op++) total += g_mix[op];
+    int r = rand_r(&c->seed) % total;
+    for (int op = first; op <= last; op++) {
+        if (r < g_mix[op]) return (op_t)op;
+        r -= g_mix[op];
+    }
+    return (op_t)first;
+}
+
+// Envoie la commande suivante ; sa mesure commence à l'instant prévu (c->next) et non
+// à l'envoi, pour que le retard pris par le serveur compte dans la latence
+static void conn_send(worker_t *w, conn_t *c) {
+    char buf[256];
+    int len = 0;
+    op_t op = conn_pick(c);
+    uint32_t last = __atomic_load_n(&g_last_id, __ATOMIC_RELAXED);
+
+    // Pas de ticket connu à prendre, rien à clore : on prend, sinon on liste
+    if (op == OP_CLOSE && c->ntaken == 0) op = OP_TAKE;
+    if (op == OP_TAKE && last == 0) op = OP_LIST;
+
+    c->op = op;
+    c->frames_left = 1;
+    switch (op) {
+        case OP_NEW:
+            len = snprintf(buf, sizeof(buf), "sendTicket -new \"Charge %d\" \"Ticket de charge de lg-user-%d\"\n",
+                           rand_r(&c->seed) % 1000, c->num);
+            break;
+        case OP_MYLIST:
+            len = g_cfg.list_limit ? snprintf(buf, sizeof(buf), "sendTicket -l --limit %d\n", g_cfg.list_limit)
+                                   : snprintf(buf, sizeof(buf), "sendTicket -l\n");
+            break;
+        case OP_LIST:
+            len = g_cfg.list_limit ? snprintf(buf, sizeof(buf), "list --limit %d\n", g_cfg.list_limit)
+                                   : snprintf(buf, sizeof(buf), "list\n");
+            break;
+        case OP_TAKE: {
+            uint32_t window = last < TAKE_WINDOW ? last : TAKE_WINDOW;
+            c->target = last - (uint32_t)rand_r(&c->seed) % window;
+            len = snprintf(buf, sizeof(buf), "take %u\n", c->target);
+            break;
+        }
+        case OP_CLOSE:
+            c->target = c->taken[--c->ntaken];
+            len = snprintf(buf, sizeof(buf), "close %u\n", c->target);
+            break;
+        case OP_EXIT:
+            // Questionnaire de sortie envoyé d'un coup : une réponse délimitée par ligne
+            len = snprintf(buf, sizeof(buf), "exit\n3\n4\n5\n");
+            c->frames_left = 4;
+            break;
+        default:
+            break;
+    }
+    c->start = c->next;
+    c->phase = PH_WAIT;
+    if (send(c->fd, buf, (size_t)len, MSG_NOSIGNAL) != len) {
+        w->errors++;
+        conn_reopen(w, c);
+    }
+}
+
+// Réponse complète : mesure, puis prochaine commande prévue
+static void conn_complete(worker_t *w, conn_t *c, uint64_t now) {
+    // Les connexions ouvertes avant le début de la mesure (start = 0) ne comptent pas
+    if (c->start != 0) {
+        hist_record(&w->hist[c->op], now > c->start ? now - c->start : 0);
+        __atomic_fetch_add(&g_done, 1, __ATOMIC_RELAXED);
+    }
+
+    // Après IDENT, le rythme repart de la fin de la connexion
+    if (c->op == OP_IDENT) c->next = now;
+    c->next = c->interval ? c->next + c->interval : now;
+    c->phase = PH_IDLE;
+    if (c->op == OP_EXIT) conn_reopen(w, c); // La reconnexion est mesurée comme un IDENT
+}
+
+// Traite une ligne de réponse (sans le \n)
+static void conn_line(worker_t *w, conn_t *c, const char *line, uint64_t now) {
+    if (strcmp(line, ".") == 0) {
+        if (--c->frames_left == 0) conn_complete(w, c, now);
+        return;
+    }
+    if (strncmp(line, CREATED_PREFIX, sizeof(CREATED_PREFIX) - 1) == 0) {
+        uint32_t id = (uint32_t)strtoul(line + sizeof(CREATED_PREFIX) - 1, NULL, 10);
+        uint32_t cur = __atomic_load_n(&g_last_id, __ATOMIC_RELAXED);
+        while (id > cur && !__atomic_compare_exchange_n(&g_last_id, &cur, id, 1,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            ;
+    } else if (strcmp(line, "Ticket pris en charge.") == 0 && c->op == OP_TAKE && c->ntaken < MAX_TAKEN) {
+        c->taken[c->ntaken++] = c->target;
+    }
+}
+
+// Lit tout ce qui est disponible et traite les lignes complètes
+static void conn_readable(worker_t *w, conn_t *c) {
+    char buf[16384];
+
+    while (c->fd >= 0) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            // Fermeture attendue seulement après exit (déjà rouverte dans conn_complete)
+            w->errors++;
+            conn_reopen(w, c);
+            return;
+        }
+        uint64_t now = now_ns();
+        for (ssize_t i = 0; i < n && c->fd >= 0; i++) {
+            if (buf[i] != '\n') {
+                // Ligne trop longue pour être interprétée : seule sa fin compte (jamais ".")
+                if (c->inlen < IN_BUF - 1) c->in[c->inlen++] = buf[i];
+                continue;
+            }
+            c->in[c->inlen] = '\0';
+            c->inlen = 0;
+            int fd = c->fd;
+            conn_line(w, c, c->in, now);
+            // exit : le reste du tampon appartient à l'ancienne connexion
+            if (c->fd != fd) return;
+        }
+    }
+}
+
+/* -------------------
+ * Threads de charge
+ * ------------------- */
+
+static void *worker_thread(void *arg) {
+    worker_t *w = arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!g_stop) {
+        uint64_t now = now_ns(), wake = now + 100000000ull;
+
+        // Envoie les commandes dues, et cherche la prochaine échéance
+        for (int i = 0; i < w->nconns; i++) {
+            conn_t *c = &w->conns[i];
+            if (c->phase != PH_IDLE) continue;
+            if (c->next <= now) conn_send(w, c);
+            else if (c->next < wake) wake = c->next;
+        }
+
+        int timeout = (int)((wake - now + 999999) / 1000000);
+        int n = epoll_wait(w->epfd, events, MAX_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) perror_exit("Erreur epoll_wait");
+        for (int i = 0; i < n; i++)
+            conn_readable(w, events[i].data.ptr);
+    }
+    return NULL;
+}
+
+/* -------------------
+ * Rapport
+ * ------------------- */
+
+static void report(worker_t *workers, int nworkers, double seconds) {
+    histogram_t *all = calloc(OP_COUNT, sizeof(*all));
+    uint64_t total = 0, errors = 0;
+
+    if (!all) perror_exit("Erreur d'allocation");
+    for (int t = 0; t < nworkers; t++) {
+        for (int op = 0; op < OP_COUNT; op++) hist_merge(&all[op], &workers[t].hist[op]);
+        errors += workers[t].errors;
+    }
+
+    // Largeurs ajustées : é et µ occupent deux octets
+    printf("\n%-16s %10s %11s %11s %11s %11s %11s\n",
+           "Commande", "Nombre", "Débit/s", "p50 (µs)", "p99 (µs)", "p999 (µs)", "max (µs)");
+    for (int op = 0; op < OP_COUNT; op++) {
+        histogram_t *h = &all[op];
+        if (h->total == 0) continue;
+        total += h->total;
+        printf("%-16s %10" PRIu64 " %10.0f %10.1f %10.1f %10.1f %10.1f\n",
+               op_names[op], h->total, (double)h->total / seconds,
+               hist_percentile(h, 0.50) / 1e3, hist_percentile(h, 0.99) / 1e3,
+               hist_percentile(h, 0.999) / 1e3, h->max / 1e3);
+    }
+    printf("Total : %" PRIu64 " commandes en %.1f s (%.0f/s), %" PRIu64 " erreur(s)\n",
+           total, seconds, (double)total / seconds, errors);
+    free(all);
+}
+
+/* -------------------
+ * Fonction principale
+ * ------------------- */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [--host IP] [--port P] [--connections N] [--techs M] [--threads T]\n"
+        "          [--duration S] [--rate R] [--mix SPEC] [--list-limit N]\n"
+        "  --connections N  connexions simultanées (défaut : %d)\n"
+        "  --techs M        dont techniciens (défaut : un quart)\n"
+        "  --threads T      threads epoll du générateur (défaut : %d)\n"
+        "  --duration S     durée de la mesure en secondes (défaut : %d)\n"
+        "  --rate R         commandes par seconde au total (défaut : au plus vite)\n"
+        "  --mix SPEC       poids des commandes, ex. new=40,mylist=15,exit=5,list=15,take=15,close=10\n"
+        "  --list-limit N   --limit des listings (défaut : %d, 0 = listing complet)\n",
+        prog, DEFAULT_CONNECTIONS, DEFAULT_THREADS, DEFAULT_DURATION, DEFAULT_LIST_LIMIT);
+}
+
+// Lit une liste nom=poids séparée par des virgules ; les commandes absentes gardent leur poids
+static int parse_mix(char *spec) {
+    for (char *tok = strtok(spec, ","); tok; tok = strtok(NULL, ",")) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        int op;
+        for (op = OP_NEW; op < OP_COUNT && strcmp(tok, op_keys[op]) != 0; op++)
+            ;
+        if (op == OP_COUNT || atoi(eq + 1) < 0) return -1;
+        g_mix[op] = atoi(eq + 1);
+    }
+    return 0;
+}
+
+static void parse_args(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"host",        required_argument, NULL, 'H'},
+        {"port",        required_argument, NULL, 'p'},
+        {"connections", required_argument, NULL, 'c'},
+        {"techs",       required_argument, NULL, 'T'},
+        {"threads",     required_argument, NULL, 't'},
+        {"duration",    required_argument, NULL, 'd'},
+        {"rate",        required_argument, NULL, 'r'},
+        {"mix",         required_argument, NULL, 'M'},
+        {"list-limit",  required_argument, NULL, 'L'},
+        {"help",        no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int c;
+
+    while ((c = getopt_long(argc, argv, "c:t:d:r:p:h", opts, NULL)) != -1) {
+        switch (c) {
+            case 'H': g_cfg.host = optarg; break;
+            case 'p': g_cfg.port = atoi(optarg); break;
+            case 'c': g_cfg.connections = atoi(optarg); break;
+            case 'T': g_cfg.techs = atoi(optarg); break;
+            case 't': g_cfg.threads = atoi(optarg); break;
+            case 'd': g_cfg.duration = atoi(optarg); break;
+            case 'r': g_cfg.rate = atof(optarg); break;
+            case 'L': g_cfg.list_limit = atoi(optarg); break;
+            case 'M':
+                if (parse_mix(optarg) != 0) {
+                    fprintf(stderr, "Mélange invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (g_cfg.techs < 0) g_cfg.techs = g_cfg.connections / 4;
+    if (g_cfg.connections <= 0 || g_cfg.connections > MAX_CONNECTIONS || g_cfg.techs > g_cfg.connections ||
+        g_cfg.threads <= 0 || g_cfg.threads > MAX_THREADS || g_cfg.duration <= 0 || g_cfg.rate < 0 ||
+        g_cfg.list_limit < 0 || g_cfg.port <= 0 || g_cfg.port > 65535) {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if ((g_cfg.techs < g_cfg.connections && g_mix[OP_NEW] + g_mix[OP_MYLIST] + g_mix[OP_EXIT] == 0) ||
+        (g_cfg.techs > 0 && g_mix[OP_LIST] + g_mix[OP_TAKE] + g_mix[OP_CLOSE] == 0)) {
+        fprintf(stderr, "Le mélange ne donne aucune commande à un des rôles\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+
+    g_addr.sin_family = AF_INET;
+    g_addr.sin_port = htons((uint16_t)g_cfg.port);
+    if (inet_pton(AF_INET, g_cfg.host, &g_addr.sin_addr) != 1) {
+        fprintf(stderr, "Adresse IP invalide : %s\n", g_cfg.host);
+        return EXIT_FAILURE;
+    }
+
+    int nworkers = g_cfg.threads < g_cfg.connections ? g_cfg.threads : g_cfg.connections;
+    worker_t *workers = calloc((size_t)nworkers, sizeof(*workers));
+    conn_t *conns = calloc((size_t)g_cfg.connections, sizeof(*conns));
+    if (!workers || !conns) perror_exit("Erreur d'allocation");
+
+    // Chaque connexion garde le même rythme : interval = connexions / débit
+    uint64_t interval = g_cfg.rate > 0 ? (uint64_t)(1e9 * g_cfg.connections / g_cfg.rate) : 0;
+    for (int t = 0; t < nworkers; t++) {
+        worker_t *w = &workers[t];
+        int first = (int)((int64_t)g_cfg.connections * t / nworkers);
+        w->epfd = epoll_create1(0);
+        if (w->epfd < 0) perror_exit("Erreur epoll_create1");
+        w->conns = conns + first;
+        w->nconns = (int)((int64_t)g_cfg.connections * (t + 1) / nworkers) - first;
+        for (int i = 0; i < w->nconns; i++) {
+            conn_t *c = &w->conns[i];
+            int k = first + i;
+            c->tech = k < g_cfg.techs;
+            c->num = c->tech ? k : k - g_cfg.techs;
+            c->seed = (unsigned)k * 2654435761u + 1;
+            c->interval = interval;
+            if (conn_open(w, c, 0) != 0) perror_exit("Erreur connexion serveur");
+        }
+    }
+
+    printf("Charge : %d connexion(s) dont %d technicien(s), %d thread(s), %d s, ",
+           g_cfg.connections, g_cfg.techs, nworkers, g_cfg.duration);
+    if (g_cfg.rate > 0) printf("%.0f commandes/s visées\n", g_cfg.rate);
+    else printf("au plus vite\n");
+
+    for (int t = 0; t < nworkers; t++)
+        if (pthread_create(&workers[t].tid, NULL, worker_thread, &workers[t]) != 0)
+            perror_exit("Erreur pthread_create");
+
+    // Débit de chaque seconde pendant la mesure
+    uint64_t start = now_ns(), prev = 0;
+    for (int s = 1; s <= g_cfg.duration; s++) {
+        struct timespec deadline = { 0, 0 };
+        uint64_t target = start + (uint64_t)s * 1000000000ull;
+        uint64_t cur = now_ns();
+        if (target > cur) {
+            deadline.tv_sec = (time_t)((target - cur) / 1000000000ull);
+            deadline.tv_nsec = (long)((target - cur) % 1000000000ull);
+            nanosleep(&deadline, NULL);
+        }
+        uint64_t done = __atomic_load_n(&g_done, __ATOMIC_RELAXED);
+        printf("[%3d s] %8" PRIu64 " commandes/s\n", s, done - prev);
+        fflush(stdout);
+        prev = done;
+    }
+    g_stop = 1;
+    double seconds = (double)(now_ns() - start) / 1e9;
+    for (int t = 0; t < nworkers; t++) pthread_join(workers[t].tid, NULL);
+
+    report(workers, nworkers, seconds);
+
+    for (int i = 0; i < g_cfg.connections; i++) conn_close(&conns[i]);
+    for (int t = 0; t < nworkers; t++) close(workers[t].epfd);
+    free(conns);
+    free(workers);
+    return EXIT_SUCCESS;
+}
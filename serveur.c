@@ -3,13 +3,14 @@
  * Serveur de ticketing :
  * - écoute TCP 127.0.0.1:12345
  * - mémoire partagée POSIX /ticket_shm
- * - mutex dans la mémoire partagée (PTHREAD_PROCESS_SHARED)
+ * - mutex dans la mémoire partagée (PTHREAD_PROCESS_SHARED, robustes)
+ * - boucle epoll (edge-triggered) + pool de workers, ou un thread par client (--mode threads)
+ * - un ou plusieurs processus (--workers N) sur le même port et le même stockage
  *
  * Simplifié pour usage pédagogique.
  */
 
-#define _POSIX_C_SOURCE 200809L  // Active certaines fonctions POSIX modernes
-#define MAX_FEEDBACK 50
+#define _GNU_SOURCE              // Fonctions POSIX modernes + pthread_setaffinity_np, accept4, getopt_long
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,616 +20,6245 @@
 #include <fcntl.h>
 #include <sys/mman.h>     // Pour mmap, shm_open
 #include <sys/stat.h>
+#include <sys/file.h>     // Pour flock
 #include <sys/socket.h>
 #include <arpa/inet.h>    // Pour les sockets TCP/IP
 #include <pthread.h>      // Pour les threads et mutex partagés
+#include <sched.h>        // Pour l'affinité CPU des workers
+#include <getopt.h>       // Pour les options de la ligne de commande
+#include <sys/epoll.h>    // Pour la boucle événementielle
+#include <sys/eventfd.h>  // Pour réveiller les workers epoll (watch)
+#include <sys/uio.h>      // Pour writev
 #include <inttypes.h>     // Pour les types entiers fixes
+#include <stddef.h>       // Pour offsetof
+#include <dirent.h>       // Pour lister les segments du journal et des archives
+#include <signal.h>       // Pour kill (processus encore vivant ?)
+#include <sys/wait.h>     // Pour waitpid (superviseur des workers)
+#include <sys/prctl.h>    // Pour PR_SET_PDEATHSIG
+#include <sys/syscall.h>  // Pour futex
+#include <linux/futex.h>
+#include <limits.h>
 
 // Constantes générales
 #define SHM_NAME "/ticket_shm"      // Nom de la mémoire partagée POSIX
-#define MAX_TICKETS 5               // Nombre maximum de tickets en mémoire
+#define SHM_FILE "./shared_mem.dat" // Fichier mappé contenant le stockage
+#define SHM_MAGIC 0x544b5446u       // Format du fichier mappé
+#define SHM_RESERVE (1ULL << 35)    // Espace d'adressage réservé au mappage (32 Gio)
+#define SHM_INITIAL_SIZE (1 << 20)  // Taille initiale du fichier
+#define SHM_ALIGN 64                // Alignement des allocations (ligne de cache)
+#define SLAB_TICKETS 1024           // Tickets par page de stockage
+#define MAX_SLABS 8192              // Pages de tickets max (≈ 8 millions de tickets)
+#define TEXT_CHUNK (1 << 20)        // Bloc de l'arène des textes de tickets
+#define ID_INDEX_INITIAL 4096       // Taille initiale de l'index ID -> slot (puissance de 2)
+#define ID_TOMBSTONE 0xFFFFFFFFu    // Entrée supprimée de l'index ID -> slot
+#define USER_PAGE 1024              // Entrées par page de l'annuaire des utilisateurs
+#define MAX_USER_PAGES 1024         // Pages de l'annuaire max (≈ 1 million d'utilisateurs)
+#define USER_INDEX_INITIAL 2048     // Taille initiale de la table nom -> utilisateur (puissance de 2)
+#define SEARCH_INDEX_INITIAL 4096   // Taille initiale du dictionnaire des termes (puissance de 2)
+#define SEARCH_TERM_MAX 24          // Taille d'un terme indexé, '\0' compris (au-delà : tronqué)
+#define SEARCH_TERM_MIN 2           // Termes plus courts ignorés
+#define SEARCH_POSTINGS_INITIAL 64  // Octets initiaux de la liste des tickets d'un terme
+#define SEARCH_MAX_TERMS 16         // Termes par requête
+#define SEARCH_DEFAULT_LIMIT 20     // Résultats affichés par défaut
+#define LOCK_STRIPES 64             // Verrous par tranche de slots
+#define SEQ_READ_RETRIES 8          // Lectures optimistes tentées avant de prendre le verrou
+#define FEEDBACK_DEFAULT_CAPACITY 50 // Avis conservés par défaut (--feedback-capacity)
+#define FEEDBACK_SPIN_LIMIT 1000    // Attentes avant de reprendre un avis dont l'écrivain a disparu
+#define WAL_FILE "./tickets.wal"    // Préfixe des segments du journal (suivi du LSN de début)
+#define SNAPSHOT_FILE "./tickets.snap" // Dernier point de reprise
+#define SNAPSHOT_MAGIC 0x4e534b54u  // "TKSN"
+#define SNAPSHOT_VERSION 1
+#define WAL_RING_SIZE (4 << 20)     // Tampon partagé des enregistrements pas encore sur disque
+#define WAL_RECORD_MAX 1024         // Taille maximale d'un enregistrement
+#define WAL_CHECKPOINT_BYTES (64ULL << 20) // Journal accumulé qui déclenche un point de reprise
+#define CHECKPOINT_INTERVAL 300     // Délai maximal entre deux points de reprise (secondes)
+#define STATS_SLOTS 512             // Blocs de compteurs (un par thread vivant)
+#define STATS_BUCKETS 24            // Cases de l'histogramme des durées (puissances de 2 en µs)
+#define STATS_INTERVAL 10           // Délai par défaut entre deux vidages des statistiques
+#define AUDIT_MAGIC "TKAUDIT1"      // En-tête d'un fichier d'audit
+#define AUDIT_RING_SIZE 4096        // Événements en attente par thread (puissance de 2)
+#define AUDIT_BUF_SIZE (256*1024)   // Lot écrit d'un coup par le thread d'audit
+#define AUDIT_FLUSH_MS 100          // Attente maximale d'un événement avant son écriture
+#define AUDIT_SYNC_MS 1000          // Délai entre deux fdatasync du fichier d'audit
+#define AUDIT_MAX_SIZE 64           // Taille d'un fichier d'audit avant rotation (Mio, par défaut)
+#define CHANGE_RING_SIZE 65536      // Changements conservés pour les abonnés (watch)
+#define WATCH_QUEUE_MAX (64*1024)   // Sortie en attente d'un abonné au-delà de laquelle ses changements attendent
+#define WATCH_COALESCE 4096         // Retard (en changements) au-delà duquel l'abonné reçoit l'état actuel des tickets
+#define WATCH_CHECK_MS 1000         // Réveil périodique du thread de suivi
+#define ARCHIVE_FILE "./tickets.arch" // Préfixe des segments d'archive (suivi de leur numéro)
+#define ARCHIVE_MAGIC "TKARCH01"    // En-tête d'un segment d'archive
+#define ARCHIVE_MAX_SEGMENTS 4096   // Segments d'archive max
+#define ARCHIVE_SEGMENT_TICKETS 65536 // Tickets par segment au plus
+#define ARCHIVE_MIN_TICKETS 1024    // Tickets archivés d'un coup, sauf s'ils attendent depuis longtemps
+#define ARCHIVE_INDEX_STEP 64       // Un ticket sur ARCHIVE_INDEX_STEP dans l'index clairsemé d'un segment
+#define ARCHIVE_RELEASE_BATCH 1024  // Slots rendus par prise d'index_lock après l'archivage
+#define ARCHIVE_INTERVAL 10         // Secondes max entre deux passages du compacteur
+#define ARCHIVE_REF 0x80000000u     // Référence vers un ticket archivé : slot = ARCHIVE_REF | segment
+#define WAL_OWNER_CHECK_MS 100      // Délai entre deux vérifications que l'écrivain du journal est vivant
 #define MAX_TITLE 128
 #define MAX_DESC 512
 #define MAX_USER 64
 #define SERVER_PORT 12345           // Port TCP du serveur
 #define BACKLOG 10                  // File d’attente de connexions
 #define BUFSIZE 1024
+#define MAX_LINE 4096               // Taille maximale d'une ligne de commande
+#define OUT_CHUNK 16384             // Taille d'un morceau de la file de sortie d'une session
+#define OUT_HIGH_WATER (256*1024)   // Sortie en attente au-delà de laquelle on cesse de lire le client
+#define FLUSH_IOV 64                // Morceaux envoyés par writev
+#define LIST_ENTRY_MAX 1024         // Taille maximale d'un ticket mis en forme
+#define LIST_CACHE_ENTRIES 8192     // Tickets mis en forme gardés par thread (puissance de 2)
+#define BATCH_MAX 1000              // Tickets par lot (sendTicket -batch, take/close de plusieurs ID)
 #define PRIORITY_SECONDS (24*3600)  // 24 heures pour devenir prioritaire
+#define TECH_CAPACITY 5             // Tickets IN_PROGRESS par technicien, par défaut (--tech-capacity)
+#define TECH_CAPACITY_MAX 1000      // Capacité maximale d'un technicien
+#define TECH_TABLE_INITIAL 64       // Cases initiales des techniciens connectés et disponibles
+#define ESCALATOR_MAX_SLEEP 60      // Réveil périodique de l'escalade (secondes)
+
+#define MAX_EVENTS 64               // Événements epoll traités par itération
+#define MAX_WORKERS 256             // Nombre maximum de workers epoll
+#define MAX_PROCESSES 64            // Nombre maximum de processus (--workers)
+#define WORKER_MIN_UPTIME 2         // Un worker mort plus tôt a échoué à démarrer (secondes)
+
+#define BENCH_SHM_FILE "./bench_mem.dat" // Fichier mappé des bancs d'essai
+#define BENCH_SECONDS 2             // Durée de chaque mesure
+#define BENCH_OWNERS 64             // Utilisateurs créés pour les bancs d'essai
+#define BENCH_TICKETS_PER_OWNER 32
+#define BENCH_WRITERS 2             // Threads écrivains du banc "locks"
 
 // États possibles d’un ticket
 typedef enum {OPEN=0, IN_PROGRESS=1, CLOSED=2, PRIORITY=3} ticket_state_t;
 
-// Structure d’arguments pour un thread client
-typedef struct {
-    int sock;
-} client_thread_arg_t;
+// Modes de fonctionnement du serveur
+typedef enum {MODE_EPOLL=0, MODE_THREADS=1} server_mode_t;
+
+// Configuration issue de la ligne de commande
+typedef struct {
+    server_mode_t mode;             // epoll + pool de workers, ou un thread par client
+    int workers;                    // Nombre de workers epoll (0 = un par coeur)
+    int pin_workers;                // Épingle chaque worker sur un coeur
+    int global_lock;                // Tout sous index_lock, lectures comprises (comparaison)
+    const char *shm_path;           // Fichier mappé
+    const char *bench;              // Banc d'essai à exécuter au lieu de servir (NULL = aucun)
+    uint32_t feedback_capacity;     // Taille de l'anneau des avis
+    const char *wal_path;           // Préfixe des segments du journal (NULL = pas de journal)
+    const char *snapshot_path;      // Fichier du point de reprise
+    int checkpoint_interval;        // Secondes entre deux points de reprise
+    const char *stats_path;         // Fichier des statistiques vidées périodiquement (NULL = aucun)
+    int stats_interval;             // Secondes entre deux vidages
+    int processes;                  // Processus workers sous un superviseur (0 = un seul processus)
+    const char *audit_path;         // Préfixe des fichiers d'audit (NULL = pas d'audit)
+    uint32_t audit_max_mb;          // Taille d'un fichier d'audit avant rotation (Mio)
+    uint32_t tech_capacity;         // Tickets IN_PROGRESS par technicien (sauf capacity propre)
+    int dispatch_open;              // La répartition assigne aussi les tickets OPEN
+    const char *archive_path;       // Préfixe des segments d'archive
+    int archive_after;              // Âge (secondes) des tickets CLOSED archivés (0 = pas d'archivage)
+    int list_cache;                 // Garde le texte des tickets listés (cache par thread)
+} server_config_t;
+
+static server_config_t g_cfg = { MODE_EPOLL, 0, 1, 0, SHM_FILE, NULL, FEEDBACK_DEFAULT_CAPACITY,
+                                 WAL_FILE, SNAPSHOT_FILE, CHECKPOINT_INTERVAL, NULL, STATS_INTERVAL, 0,
+                                 NULL, AUDIT_MAX_SIZE, TECH_CAPACITY, 0, ARCHIVE_FILE, 0, 1 };
+
+// Chaînage intrusif entre tickets (slot+1, 0 = aucun)
+typedef struct {
+    uint32_t prev;
+    uint32_t next;
+} list_link_t;
+
+// Tête d'une liste intrusive de tickets
+typedef struct {
+    uint32_t head;                  // Premier slot+1 (0 = liste vide)
+    uint32_t tail;                  // Dernier slot+1
+    uint32_t count;
+    uint32_t seq;                   // Seqlock : impair pendant une modification de la liste
+} list_head_t;
+
+// Partie "chaude" d'un ticket stocké : tout ce que lisent les parcours (listes,
+// escalade, comptages, reconstruction), sur une seule ligne de cache
+typedef struct {
+    uint32_t id;                    // ID unique du ticket (0 = slot libre)
+    uint32_t seq;                   // Seqlock du contenu : impair pendant une écriture
+    uint32_t next_free;             // Slot libre suivant (slot+1, 0 = fin) quand le slot est libre
+    ticket_state_t state;           // État du ticket
+    time_t created;                 // Date/heure de création
+    uint32_t owner_uid;             // Propriétaire (uid dans l'annuaire)
+    uint32_t tech_uid;              // Technicien assigné (uid+1, 0 = aucun)
+    list_link_t owner_link;         // Chaînage dans la liste des tickets du propriétaire
+    list_link_t tech_link;          // Chaînage dans la liste des tickets du technicien assigné
+    list_link_t state_link;         // Chaînage dans la liste de son état
+    uint64_t text;                  // Offset du texte du ticket dans l'arène (0 = slot libre)
+} __attribute__((aligned(64))) ticket_hot_t;
+
+// Texte d'un ticket dans l'arène, écrit une fois à la création et jamais modifié :
+// longueurs puis titre et description terminés par '\0'
+typedef struct {
+    uint16_t title_len;
+    uint16_t desc_len;
+    char data[];
+} ticket_text_t;
+
+// Copie complète d'un ticket, noms résolus (lecture, journal, reprise)
+typedef struct {
+    uint32_t id;                    // ID unique du ticket (0 = slot libre)
+    ticket_state_t state;           // État du ticket
+    time_t created;                 // Date/heure de création
+    uint32_t owner_uid;             // Comme dans ticket_hot_t
+    uint32_t tech_uid;
+    char title[MAX_TITLE];          // Titre
+    char desc[MAX_DESC];            // Description
+    char owner[MAX_USER];           // Utilisateur ayant créé le ticket
+    char technician[MAX_USER];      // Technicien assigné (ou vide)
+} ticket_t;
+
+// Entrée de l'index ID -> slot (adressage ouvert, id 0 = case vide)
+typedef struct {
+    uint32_t id;
+    uint32_t slot;
+} id_index_entry_t;
+
+// Entrée de l'annuaire des utilisateurs
+typedef struct {
+    char name[MAX_USER];
+    list_head_t owned;              // Tickets créés par l'utilisateur, par ID croissant
+    list_head_t assigned;           // Tickets assignés au technicien (tous états), par ID croissant
+    uint32_t in_progress;           // Tickets IN_PROGRESS assignés au technicien (atomique)
+    uint32_t online;                // Sessions de technicien connectées (répartition)
+    uint32_t capacity;              // Tickets IN_PROGRESS au plus (0 = --tech-capacity)
+    uint32_t heap_pos;              // Place dans le tas des techniciens disponibles + 1 (0 = absent)
+} user_entry_t;
+
+// Session de technicien connectée (candidate à la répartition)
+typedef struct {
+    pid_t pid;                      // Processus de la session (0 = case libre)
+    uint32_t uid;
+} tech_online_t;
+
+// Terme du dictionnaire de recherche et sa liste de tickets (postings) : les ID par ordre
+// croissant, codés par écart avec le précédent en varint (7 bits par octet)
+typedef struct {
+    char term[SEARCH_TERM_MAX];     // Terme, complété par des '\0' (vide = case libre)
+    uint64_t postings;              // Offset des octets de la liste
+    uint32_t bytes;                 // Octets écrits
+    uint32_t cap;                   // Octets alloués
+    uint32_t count;                 // Tickets dans la liste
+    uint32_t last_id;               // Dernier ID ajouté (base de l'écart suivant)
+} search_term_t;
+
+// Verrou d'une tranche de slots, seul sur sa ligne de cache
+typedef struct {
+    pthread_mutex_t m;
+} __attribute__((aligned(64))) stripe_lock_t;
+
+// Structure d’un feedback utilisateur
+typedef struct {
+    char username[MAX_USER];
+    int note_reactivite;
+    int note_competence;
+    int note_satisfaction;
+} feedback_t;
+
+// Case de l'anneau des feedbacks
+typedef struct {
+    uint64_t seq;                   // 2*(pos+1) une fois l'avis n° pos écrit, impair pendant l'écriture
+    feedback_t f;
+} feedback_slot_t;
+
+// Case de l'anneau des changements (commande watch)
+typedef struct {
+    uint64_t seq;                   // 2*(n+1) une fois le changement n° n écrit, impair pendant l'écriture
+    uint32_t id;                    // Ticket modifié
+    uint32_t state;                 // Son état après le changement
+    uint32_t tech_uid;              // Technicien assigné (uid+1, 0 = aucun)
+} change_t;
+
+// Segment d'archive publié (table de la mémoire partagée)
+typedef struct {
+    uint32_t seq;                   // Numéro du segment (nom du fichier)
+    uint32_t count;                 // Tickets du segment
+    uint32_t first_id;              // Plus petit et plus grand ID (les plages de deux segments
+    uint32_t last_id;               //   peuvent se chevaucher)
+    uint64_t size;                  // Taille du fichier
+} archive_segment_t;
+
+// --- Structure partagée entre processus ---
+// En-tête placé au début de shared_mem.dat. Le reste du fichier est un tas alloué
+// linéairement (pages de tickets, ...) : toutes les références y sont des offsets
+// depuis g_shm, valables dans chaque processus quelle que soit l'adresse du mappage.
+// Synchronisation (tous les verrous sont PTHREAD_PROCESS_SHARED) :
+// - index_lock protège la structure : allocation, index ID, annuaire, listes ;
+// - slot_locks[slot % LOCK_STRIPES] protège le contenu d'un ticket (état, technicien),
+//   toujours pris après index_lock, jamais l'inverse ;
+// - wal_lock protège le tampon du journal, pris en dernier (sous les deux précédents) ;
+//   on attend son écriture sur disque par futex : une variable de condition partagée
+//   resterait bloquée par un processus mort pendant qu'il l'attendait ;
+// - les tickets, les listes et l'annuaire portent un compteur de séquence : les listings
+//   les lisent sans verrou et recommencent si un écrivain est passé entre-temps.
+// Les verrous sont robustes : celui d'un processus mort revient au suivant (EOWNERDEAD),
+// qui remet en état ce qu'il protège (voir store_repair, stripe_repair, wal_wait_locked).
+typedef struct {
+    pthread_mutex_t index_lock;     // Verrou de la structure du stockage
+    stripe_lock_t slot_locks[LOCK_STRIPES];
+    uint32_t magic;                 // SHM_MAGIC une fois le fichier formaté
+    int initialized;                // Indique si la mémoire est initialisée
+    uint64_t file_size;             // Taille actuelle du fichier
+    uint64_t heap_top;              // Premier octet libre du tas
+    uint32_t next_id;               // Prochain ID de ticket
+    uint32_t slab_count;            // Pages de tickets allouées
+    uint32_t slot_count;            // Slots déjà distribués (les suivants sont vierges)
+    uint32_t free_head;             // Liste des slots libérés (slot+1, 0 = vide)
+    uint32_t live_tickets;          // Tickets présents dans le stockage
+    uint64_t id_index;              // Offset de la table ID -> slot
+    uint32_t id_index_cap;          // Nombre de cases (puissance de 2)
+    uint32_t id_index_used;         // Cases occupées, tombes comprises
+    uint64_t user_index;            // Offset de la table nom -> utilisateur (uid+1, 0 = vide)
+    uint32_t user_index_cap;        // Nombre de cases (puissance de 2)
+    uint32_t user_count;
+    uint32_t dir_seq;               // Seqlock de l'annuaire (table et pages)
+    uint64_t user_pages[MAX_USER_PAGES]; // Offset de chaque page de USER_PAGE entrées (jamais déplacées)
+    list_head_t state_lists[4];     // Tickets de chaque état par ID croissant (OPEN : donc par échéance d'escalade)
+    uint64_t feedback_head;         // Nombre d'avis réservés depuis le début (atomique)
+    uint64_t feedback_ring;         // Offset de l'anneau des avis
+    uint32_t feedback_cap;          // Nombre de cases de l'anneau
+    uint64_t change_ring;           // Offset de l'anneau des changements (CHANGE_RING_SIZE cases)
+    uint64_t change_head;           // Changements publiés depuis le formatage
+    uint32_t change_wake;           // Avance quand des changements attendent des abonnés (futex)
+    uint64_t tech_online;           // Offset des sessions de techniciens connectées (tech_online_t)
+    uint32_t tech_online_cap;       // Nombre de cases
+    uint32_t tech_online_used;      // Cases déjà utilisées (les suivantes sont vierges)
+    uint32_t tech_online_count;     // Sessions enregistrées
+    uint64_t tech_heap;             // Offset du tas des techniciens disponibles (uid)
+    uint32_t tech_heap_cap;         // Nombre de cases
+    uint32_t tech_heap_len;         // Techniciens dans le tas
+    uint32_t watchers;              // Abonnés (watch) de tous les processus (ceux d'un processus tué
+                                    //   restent comptés jusqu'au prochain démarrage : réveils inutiles)
+    pthread_mutex_t wal_lock;       // Verrou du tampon du journal
+    uint32_t wal_wake;              // Avance à chaque écriture du journal sur disque (futex)
+    uint64_t wal_ring;              // Offset du tampon circulaire du journal (WAL_RING_SIZE octets)
+    uint64_t wal_append;            // LSN du prochain enregistrement (position dans le journal)
+    uint64_t wal_durable;           // Le journal est sur disque jusqu'à ce LSN
+    uint64_t wal_segment;           // LSN de début du segment courant
+    int wal_flushing;               // Un processus écrit le journal (un seul à la fois)
+    pid_t wal_flusher;              // Processus qui écrit le journal
+    int repair_needed;              // Un processus est mort au milieu d'une écriture : index à refaire
+    pthread_mutex_t ckpt_lock;      // Un seul point de reprise à la fois
+    uint64_t ckpt_lsn;              // LSN du dernier point de reprise
+    time_t ckpt_time;               // Date du dernier point de reprise
+    uint64_t text_chunk;            // Offset du bloc courant de l'arène des textes (0 = aucun)
+    uint64_t text_used;             // Octets occupés dans ce bloc
+    uint64_t stats;                 // Offset des STATS_SLOTS blocs de compteurs
+    uint64_t search_index;          // Offset du dictionnaire des termes (search_term_t)
+    uint32_t search_cap;            // Nombre de cases (puissance de 2)
+    uint32_t search_used;           // Termes présents
+    uint32_t search_seq;            // Seqlock du dictionnaire et des listes de postings
+    uint64_t search_bytes;          // Octets de postings écrits
+    pthread_mutex_t archive_lock;   // Un seul compacteur à la fois
+    uint64_t archive_segments;      // Offset de la table des segments (ARCHIVE_MAX_SEGMENTS cases)
+    uint32_t archive_count;         // Segments publiés (les cases suivantes sont vides)
+    uint32_t archive_next;          // Numéro du prochain segment
+    uint64_t archive_tickets;       // Tickets archivés
+    uint64_t archive_bytes;         // Taille des segments
+    uint64_t slabs[MAX_SLABS];      // Offset de chaque page de SLAB_TICKETS tickets
+} shared_data_t;
+
+static shared_data_t *g_shm = NULL; // Pointeur global vers la mémoire partagée
+static int g_shm_fd = -1;           // Descripteur du fichier mappé (pour l'agrandir)
+
+// Segment du journal ouvert par ce processus
+static int g_wal_fd = -1;
+static uint64_t g_wal_fd_segment = 0;
+// Fin du dernier enregistrement du journal écrit par ce thread (à rendre durable avant de répondre)
+static __thread uint64_t t_wal_lsn = 0;
+
+// Réveil du thread d'escalade de ce processus quand la file OPEN reçoit une nouvelle tête
+static pthread_mutex_t g_escalator_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_escalator_cond = PTHREAD_COND_INITIALIZER;
+
+// --- Fonction utilitaire pour quitter avec message d’erreur ---
+static void perror_exit(const char *msg){
+    perror(msg);
+    exit(EXIT_FAILURE);
+}
+
+// Verrous partagés robustes : si le détenteur est mort, le verrou revient à l'appelant
+// (rc = EOWNERDEAD), qui le déclare cohérent puis doit remettre en état ce qu'il protège
+// Retourne 1 dans ce cas, 0 si le verrou a été pris normalement
+static int shm_mutex_taken(pthread_mutex_t *m, int rc) {
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(m);
+        return 1;
+    }
+    if (rc != 0) {
+        errno = rc;
+        perror_exit("Erreur lors du verrouillage d'un mutex partagé");
+    }
+    return 0;
+}
+
+static int shm_mutex_lock(pthread_mutex_t *m) {
+    return shm_mutex_taken(m, pthread_mutex_lock(m));
+}
+
+// Attend au plus ms millisecondes que *addr ne vaille plus val (futex partagé entre processus)
+static void futex_wait_ms(uint32_t *addr, uint32_t val, int ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake_all(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Alloue size octets dans le tas partagé, en agrandissant le fichier si besoin
+// Retourne l'offset de la zone (remplie de zéros), ou 0 si le stockage est plein
+// Les zones ne sont jamais rendues : un lecteur sans verrou peut encore parcourir
+// une table remplacée sans toucher de mémoire réutilisée.
+// Appelant : index_lock verrouillé
+static uint64_t shm_alloc(uint64_t size) {
+    uint64_t off = g_shm->heap_top;
+    uint64_t end = off + ((size + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1));
+
+    if (end > SHM_RESERVE) return 0;
+    if (end > g_shm->file_size) {
+        // Croissance géométrique pour amortir les ftruncate
+        uint64_t newsize = g_shm->file_size * 2;
+        while (newsize < end) newsize *= 2;
+        if (newsize > SHM_RESERVE) newsize = SHM_RESERVE;
+        if (ftruncate(g_shm_fd, (off_t)newsize) == -1) {
+            perror("Erreur lors de l'agrandissement de la mémoire partagée");
+            return 0;
+        }
+        g_shm->file_size = newsize;
+    }
+    g_shm->heap_top = end;
+    return off;
+}
+
+/* -------------------
+ * Statistiques : chaque thread compte dans son propre bloc du mappage (aucune ligne de
+ * cache partagée sur le chemin critique) ; STATS et le vidage périodique additionnent
+ * les blocs de tous les processus.
+ * ------------------- */
+
+// Commandes comptées (classées d'après leur premier mot)
+typedef enum {
+    CMD_IDENT = 0, CMD_NEW, CMD_BATCH, CMD_MYLIST, CMD_LIST, CMD_SEARCH, CMD_TAKE, CMD_CLOSE, CMD_FEEDBACK,
+    CMD_CAPACITY, CMD_WATCH, CMD_STATS, CMD_FRAMING, CMD_HELP, CMD_EXIT, CMD_NOTE, CMD_OTHER, CMD_COUNT
+} cmd_kind_t;
+
+static const char *cmd_names[CMD_COUNT] = {
+    "IDENT", "sendTicket -new", "sendTicket -batch", "sendTicket -l", "list", "search", "take", "close", "showFeedback",
+    "capacity", "watch", "STATS", "FRAMING", "help", "exit", "(note)", "(autre)"
+};
+
+// Verrous mesurés
+typedef enum { LOCK_INDEX = 0, LOCK_STRIPE, LOCK_WAL, LOCK_CLASSES } lock_class_t;
+
+static const char *lock_names[LOCK_CLASSES] = { "index", "tranches", "journal" };
+
+typedef struct {
+    uint64_t count;                 // Acquisitions
+    uint64_t contended;             // Acquisitions qui ont dû attendre
+    uint64_t wait_ns, wait_max;     // Attente avant l'acquisition
+    uint64_t hold_ns, hold_max;     // Durée de détention
+} lock_stats_t;
+
+// Bloc de compteurs d'un thread ; seul son propriétaire écrit, les lecteurs additionnent
+typedef struct {
+    uint64_t owner;                 // (pid << 1) | pris (atomique) ; pid 0 = jamais utilisé
+    uint64_t commands[CMD_COUNT];
+    uint64_t latency_ns[CMD_COUNT]; // Somme des durées d'exécution
+    uint64_t latency[CMD_COUNT][STATS_BUCKETS]; // Case b : durée < 2^b µs
+    lock_stats_t locks[LOCK_CLASSES];
+    uint64_t durable_waits;         // wal_sync qui ont attendu le disque
+    uint64_t durable_wait_ns, durable_wait_max;
+    uint64_t accepted;              // Connexions acceptées (jamais remis à zéro)
+    uint64_t sess_opened;           // Sessions ouvertes / fermées par ce thread ; remis à zéro
+    uint64_t sess_closed;           //   quand le bloc d'un processus mort est repris
+    uint64_t bytes_in, bytes_out;
+    uint64_t audit_events;          // Thread d'audit : événements écrits, dont pertes signalées
+    uint64_t audit_lost;            //   événements perdus (anneau d'un thread plein)
+    uint64_t audit_bytes;           //   octets écrits
+    uint64_t dispatched;            // Tickets assignés par la répartition
+    uint64_t dispatch_wait_ns, dispatch_wait_max; // Attente de ces tickets avant leur assignation
+    uint64_t dispatch_wait[STATS_BUCKETS]; // Case b : attente < 2^b ms
+    uint64_t watch_events;          // Changements envoyés aux abonnés (watch)
+    uint64_t watch_coalesced;       //   changements regroupés (abonné en retard)
+    uint64_t watch_lost;            //   changements perdus (abonné dépassé d'un tour)
+    uint64_t list_cache_hits;       // Tickets listés repris du cache des tickets mis en forme
+    uint64_t list_cache_misses;     //   tickets mis en forme (absents ou modifiés depuis)
+} __attribute__((aligned(64))) stats_block_t;
+
+static __thread stats_block_t *t_stats = NULL;          // Bloc du thread (NULL = non compté)
+static __thread uint64_t t_lock_since[LOCK_CLASSES];    // Début de la détention en cours
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static stats_block_t *stats_block(uint32_t i) {
+    return (stats_block_t*)((char*)g_shm + g_shm->stats) + i;
+}
+
+static int pid_alive(pid_t pid) {
+    return pid == getpid() || kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Incrément par le seul écrivain du compteur : pas d'instruction verrouillée
+static void stat_add(uint64_t *c, uint64_t v) {
+    __atomic_store_n(c, __atomic_load_n(c, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static void stat_max(uint64_t *c, uint64_t v) {
+    if (v > __atomic_load_n(c, __ATOMIC_RELAXED)) __atomic_store_n(c, v, __ATOMIC_RELAXED);
+}
+
+// Attribue un bloc au thread appelant : libre de ce processus, jamais utilisé,
+// ou laissé par un processus mort (ses sessions n'existent plus)
+static void stats_attach(void) {
+    uint64_t me = (uint64_t)getpid();
+
+    for (uint32_t i = 0; i < STATS_SLOTS && !t_stats; i++) {
+        stats_block_t *b = stats_block(i);
+        uint64_t o = __atomic_load_n(&b->owner, __ATOMIC_ACQUIRE);
+        pid_t pid = (pid_t)(o >> 1);
+        int dead = pid != 0 && (uint64_t)pid != me && !pid_alive(pid);
+        if (!dead && ((o & 1) || (pid != 0 && (uint64_t)pid != me))) continue;
+        if (!__atomic_compare_exchange_n(&b->owner, &o, (me << 1) | 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            continue;
+        if (dead) b->sess_opened = b->sess_closed = 0;
+        t_stats = b;
+    }
+}
+
+// Rend le bloc (fin d'un thread client) ; ses compteurs restent acquis
+static void stats_detach(void) {
+    if (!t_stats) return;
+    __atomic_store_n(&t_stats->owner, (uint64_t)getpid() << 1, __ATOMIC_RELEASE);
+    t_stats = NULL;
+}
+
+// Prend le verrou en mesurant l'attente (une seule lecture d'horloge s'il est libre)
+// Retourne 1 si le verrou a été repris à un processus mort (voir shm_mutex_taken)
+static int stat_lock(pthread_mutex_t *m, lock_class_t k) {
+    stats_block_t *st = t_stats;
+    if (!st) return shm_mutex_lock(m);
+
+    uint64_t t0 = now_ns(), t1 = t0;
+    lock_stats_t *l = &st->locks[k];
+    int rc = pthread_mutex_trylock(m);
+    if (rc == EBUSY) {
+        rc = pthread_mutex_lock(m);
+        t1 = now_ns();
+        stat_add(&l->contended, 1);
+        stat_add(&l->wait_ns, t1 - t0);
+        stat_max(&l->wait_max, t1 - t0);
+    }
+    stat_add(&l->count, 1);
+    t_lock_since[k] = t1;
+    return shm_mutex_taken(m, rc);
+}
+
+static void stat_unlock(pthread_mutex_t *m, lock_class_t k) {
+    stats_block_t *st = t_stats;
+    if (st) {
+        uint64_t held = now_ns() - t_lock_since[k];
+        stat_add(&st->locks[k].hold_ns, held);
+        stat_max(&st->locks[k].hold_max, held);
+    }
+    pthread_mutex_unlock(m);
+}
+
+// Compte une commande exécutée en ns nanosecondes
+static void stat_command(cmd_kind_t kind, uint64_t ns) {
+    stats_block_t *st = t_stats;
+    if (!st) return;
+
+    uint64_t us = ns / 1000;
+    int b = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    if (b >= STATS_BUCKETS) b = STATS_BUCKETS - 1;
+    stat_add(&st->commands[kind], 1);
+    stat_add(&st->latency_ns[kind], ns);
+    stat_add(&st->latency[kind][b], 1);
+}
+/* -------------------
+ * Journal d'audit : chaque thread dépose ses événements (création, prise en charge,
+ * clôture, escalade, avis) dans son propre anneau, sans verrou ni appel système ; le
+ * thread d'audit du processus les vide par lots dans un fichier binaire compact, remplacé
+ * par le suivant au-delà de --audit-max-size. Un anneau plein perd l'événement (compté,
+ * puis signalé dans le fichier) plutôt que de faire attendre le disque à une commande.
+ *
+ * Fichier <préfixe>.<processus>.<numéro> : AUDIT_MAGIC puis des enregistrements
+ *   int64 date (ns depuis l'epoch) | uint32 ticket | uint8 type | uint8 longueur du nom
+ *   | 3 notes (AUDIT_FEEDBACK seulement) | nom
+ * (ordre des octets de la machine ; auditdump.c les décode)
+ * ------------------- */
+
+typedef enum {
+    AUDIT_CREATE = 1,               // Ticket créé (nom : propriétaire)
+    AUDIT_ASSIGN,                   // Ticket pris en charge (nom : technicien)
+    AUDIT_CLOSE,                    // Ticket clos (nom : technicien)
+    AUDIT_ESCALATE,                 // Ticket passé PRIORITY (pas de nom)
+    AUDIT_FEEDBACK,                 // Avis (ticket 0, nom : client)
+    AUDIT_LOST                      // Événements perdus par un thread (ticket : leur nombre)
+} audit_type_t;
+
+// Événement en attente dans un anneau
+typedef struct {
+    int64_t time_ns;
+    uint32_t ticket;
+    uint8_t type;
+    uint8_t notes[3];
+    char actor[MAX_USER];
+} audit_event_t;
+
+// Anneau d'un thread : head avance chez le producteur, tail chez le thread d'audit
+typedef struct audit_ring {
+    uint64_t head __attribute__((aligned(64)));
+    uint64_t lost;                  // Événements perdus, anneau plein (producteur)
+    int closed;                     // Thread terminé : l'anneau est libéré une fois vidé
+    uint64_t tail __attribute__((aligned(64)));
+    uint64_t lost_logged;           // Pertes déjà signalées dans le fichier (thread d'audit)
+    struct audit_ring *next;
+    audit_event_t ev[AUDIT_RING_SIZE];
+} audit_ring_t;
+
+static int g_audit_on = 0;
+static pthread_mutex_t g_audit_lock = PTHREAD_MUTEX_INITIALIZER; // Ajout et retrait des anneaux
+static audit_ring_t *g_audit_rings = NULL;
+static uint32_t g_audit_wake = 0;   // Avance pour réveiller le thread d'audit (futex)
+static int g_audit_worker = 0;      // Processus (nom des fichiers)
+static __thread audit_ring_t *t_audit = NULL;
+
+// Crée l'anneau du thread appelant (premier événement du thread)
+static audit_ring_t *audit_attach(void) {
+    audit_ring_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    pthread_mutex_lock(&g_audit_lock);
+    r->next = g_audit_rings;
+    g_audit_rings = r;
+    pthread_mutex_unlock(&g_audit_lock);
+    t_audit = r;
+    return r;
+}
+
+// Fin d'un thread client : le thread d'audit videra puis libérera son anneau
+static void audit_detach(void) {
+    if (!t_audit) return;
+    __atomic_store_n(&t_audit->closed, 1, __ATOMIC_RELEASE);
+    t_audit = NULL;
+}
+
+// Dépose un événement dans l'anneau du thread (notes : avis seulement)
+static void audit_log(audit_type_t type, uint32_t ticket, const char *actor, const int *notes) {
+    if (!g_audit_on) return;
+    audit_ring_t *r = t_audit ? t_audit : audit_attach();
+    if (!r) return;
+
+    uint64_t head = r->head;
+    uint64_t used = head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (used == AUDIT_RING_SIZE) {
+        __atomic_store_n(&r->lost, r->lost + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    audit_event_t *e = &r->ev[head % AUDIT_RING_SIZE];
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    e->time_ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    e->ticket = ticket;
+    e->type = (uint8_t)type;
+    for (int k = 0; k < 3; k++) e->notes[k] = notes ? (uint8_t)notes[k] : 0;
+    snprintf(e->actor, sizeof(e->actor), "%s", actor ? actor : "");
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+
+    // Anneau aux trois quarts plein : le thread d'audit n'attend pas la fin de son délai
+    if (used + 1 == AUDIT_RING_SIZE * 3 / 4) {
+        __atomic_add_fetch(&g_audit_wake, 1, __ATOMIC_RELEASE);
+        futex_wake_all(&g_audit_wake);
+    }
+}
+
+// Encode un événement à la fin du lot ; retourne sa taille
+static size_t audit_encode(const audit_event_t *e, char *out) {
+    uint8_t name_len = (uint8_t)strlen(e->actor);
+    size_t n = 0;
+
+    memcpy(out + n, &e->time_ns, 8); n += 8;
+    memcpy(out + n, &e->ticket, 4); n += 4;
+    out[n++] = (char)e->type;
+    out[n++] = (char)name_len;
+    if (e->type == AUDIT_FEEDBACK) {
+        memcpy(out + n, e->notes, 3);
+        n += 3;
+    }
+    memcpy(out + n, e->actor, name_len);
+    return n + name_len;
+}
+
+// Fichier d'audit ouvert par ce processus
+static int g_audit_fd = -1;
+static uint32_t g_audit_seq = 0;
+static uint64_t g_audit_size = 0;
+
+// Ouvre le fichier suivant : un numéro de plus que le dernier présent pour ce processus
+static void audit_open_next(void) {
+    char dir[4096], prefix[256], path[4096];
+    const char *slash = strrchr(g_cfg.audit_path, '/');
+    const char *base = slash ? slash + 1 : g_cfg.audit_path;
+
+    if (g_audit_seq == 0) {
+        if (!slash) snprintf(dir, sizeof(dir), ".");
+        else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - g_cfg.audit_path) + (slash == g_cfg.audit_path), g_cfg.audit_path);
+        snprintf(prefix, sizeof(prefix), "%s.%d.", base, g_audit_worker);
+        size_t plen = strlen(prefix);
+        DIR *d = opendir(dir);
+        struct dirent *e;
+        while (d && (e = readdir(d)) != NULL) {
+            char *end;
+            if (strncmp(e->d_name, prefix, plen) != 0) continue;
+            unsigned long seq = strtoul(e->d_name + plen, &end, 10);
+            if (*end == '\0' && seq > g_audit_seq) g_audit_seq = (uint32_t)seq;
+        }
+        if (d) closedir(d);
+    }
+
+    if (g_audit_fd >= 0) {
+        fdatasync(g_audit_fd);
+        close(g_audit_fd);
+    }
+    g_audit_seq++;
+    snprintf(path, sizeof(path), "%s.%d.%06u", g_cfg.audit_path, g_audit_worker, g_audit_seq);
+    g_audit_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (g_audit_fd < 0)
+        perror_exit("Erreur lors de l'ouverture du fichier d'audit");
+    if (write(g_audit_fd, AUDIT_MAGIC, 8) != 8)
+        perror_exit("Erreur lors de l'écriture du fichier d'audit");
+    g_audit_size = 8;
+}
+
+// Écrit un lot dans le fichier courant, puis passe au suivant s'il dépasse sa taille maximale
+static void audit_write(const char *buf, size_t len) {
+    if (len == 0) return;
+    for (size_t done = 0; done < len;) {
+        ssize_t n = write(g_audit_fd, buf + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            perror("Erreur lors de l'écriture du fichier d'audit");
+            return;
+        }
+        done += (size_t)n;
+    }
+    g_audit_size += len;
+    if (t_stats) stat_add(&t_stats->audit_bytes, len);
+    if (g_audit_size >= (uint64_t)g_cfg.audit_max_mb << 20)
+        audit_open_next();
+}
+
+// Thread d'audit : vide les anneaux de tous les threads du processus, par lots
+static void *audit_thread(void *arg) {
+    char *buf = malloc(AUDIT_BUF_SIZE);
+    uint64_t last_sync = now_ns();
+    int dirty = 0;
+    (void)arg;
+
+    if (!buf) perror_exit("Erreur d'allocation du tampon d'audit");
+    stats_attach();
+    audit_open_next();
+    while (1) {
+        uint32_t seen = __atomic_load_n(&g_audit_wake, __ATOMIC_ACQUIRE);
+        size_t len = 0;
+        uint64_t events = 0;
+
+        // Les anneaux ne sont retirés que par ce thread : la liste se parcourt sans verrou
+        pthread_mutex_lock(&g_audit_lock);
+        audit_ring_t *rings = g_audit_rings;
+        pthread_mutex_unlock(&g_audit_lock);
+        for (audit_ring_t *r = rings; r; r = r->next) {
+            uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+            uint64_t lost = __atomic_load_n(&r->lost, __ATOMIC_RELAXED);
+            for (uint64_t tail = r->tail; tail < head; tail++) {
+                if (AUDIT_BUF_SIZE - len < sizeof(audit_event_t)) { audit_write(buf, len); len = 0; }
+                len += audit_encode(&r->ev[tail % AUDIT_RING_SIZE], buf + len);
+                events++;
+            }
+            __atomic_store_n(&r->tail, head, __ATOMIC_RELEASE);
+            // Pertes survenues pendant que l'anneau était plein, donc après ses événements
+            if (lost != r->lost_logged) {
+                audit_event_t e;
+                struct timespec ts;
+                memset(&e, 0, sizeof(e));
+                clock_gettime(CLOCK_REALTIME, &ts);
+                e.time_ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+                e.ticket = (uint32_t)(lost - r->lost_logged);
+                e.type = AUDIT_LOST;
+                if (t_stats) stat_add(&t_stats->audit_lost, lost - r->lost_logged);
+                r->lost_logged = lost;
+                if (AUDIT_BUF_SIZE - len < sizeof(audit_event_t)) { audit_write(buf, len); len = 0; }
+                len += audit_encode(&e, buf + len);
+                events++;
+            }
+        }
+        audit_write(buf, len);
+        if (events) {
+            dirty = 1;
+            if (t_stats) stat_add(&t_stats->audit_events, events);
+        }
+
+        // Anneaux des threads terminés, vidés
+        pthread_mutex_lock(&g_audit_lock);
+        for (audit_ring_t **pp = &g_audit_rings; *pp;) {
+            audit_ring_t *r = *pp;
+            if (__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE) && r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE)) {
+                *pp = r->next;
+                free(r);
+            } else {
+                pp = &r->next;
+            }
+        }
+        pthread_mutex_unlock(&g_audit_lock);
+
+        if (dirty && now_ns() - last_sync >= (uint64_t)AUDIT_SYNC_MS * 1000000) {
+            fdatasync(g_audit_fd);
+            last_sync = now_ns();
+            dirty = 0;
+        }
+        futex_wait_ms(&g_audit_wake, seen, AUDIT_FLUSH_MS);
+    }
+    return NULL;
+}
+
+// Démarre l'audit du processus (worker : numéro du processus dans le nom des fichiers)
+static void audit_start(int worker) {
+    pthread_t tid;
+
+    g_audit_worker = worker;
+    if (pthread_create(&tid, NULL, audit_thread, NULL) != 0)
+        perror_exit("Erreur lors de la création du thread d'audit");
+    pthread_detach(tid);
+    g_audit_on = 1;
+}
+
+/* -------------------
+ * Journal (WAL) : chaque modification ajoute un enregistrement au tampon partagé ;
+ * le premier thread qui attend la durabilité écrit sur disque et fdatasync-e pour tous
+ * (group commit). Le LSN d'un enregistrement est sa position dans le journal.
+ * Segment : fichier <wal_path>.<LSN de début>, ouvert à chaque point de reprise.
+ * Enregistrement : longueur (u32), CRC32 (u32) du reste, type (u8), contenu.
+ * ------------------- */
+
+// Types d'enregistrements ; chacun fixe une valeur (rejouer deux fois ne change rien)
+typedef enum { WAL_INSERT = 1, WAL_ASSIGN, WAL_CLOSE, WAL_ESCALATE, WAL_FEEDBACK, WAL_ARCHIVE } wal_type_t;
+
+// Encodage d'un enregistrement ou d'une entrée du point de reprise
+typedef struct {
+    unsigned char data[WAL_RECORD_MAX];
+    size_t len;
+} wbuf_t;
+
+// Lecture d'un enregistrement ; err passe à 1 en cas de débordement
+typedef struct {
+    const unsigned char *p;
+    size_t len;
+    size_t pos;
+    int err;
+} rbuf_t;
+
+static uint32_t g_crc_table[256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+static void crc32_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        g_crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+    const unsigned char *p = data;
+    pthread_once(&g_crc_once, crc32_init);
+    crc = ~crc;
+    while (len--) crc = g_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_bytes(wbuf_t *b, const void *p, size_t n) {
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+static void put_u8(wbuf_t *b, uint8_t v) { put_bytes(b, &v, sizeof(v)); }
+static void put_u32(wbuf_t *b, uint32_t v) { put_bytes(b, &v, sizeof(v)); }
+static void put_u64(wbuf_t *b, uint64_t v) { put_bytes(b, &v, sizeof(v)); }
+static void put_str(wbuf_t *b, const char *s, size_t max) {
+    uint16_t n = (uint16_t)strnlen(s, max - 1);
+    put_bytes(b, &n, sizeof(n));
+    put_bytes(b, s, n);
+}
+
+static void get_bytes(rbuf_t *r, void *p, size_t n) {
+    if (r->err || r->len - r->pos < n) { r->err = 1; memset(p, 0, n); return; }
+    memcpy(p, r->p + r->pos, n);
+    r->pos += n;
+}
+static uint8_t get_u8(rbuf_t *r) { uint8_t v; get_bytes(r, &v, sizeof(v)); return v; }
+static uint32_t get_u32(rbuf_t *r) { uint32_t v; get_bytes(r, &v, sizeof(v)); return v; }
+static uint64_t get_u64(rbuf_t *r) { uint64_t v; get_bytes(r, &v, sizeof(v)); return v; }
+static void get_str(rbuf_t *r, char *dst, size_t max) {
+    uint16_t n;
+    get_bytes(r, &n, sizeof(n));
+    if (r->err || n >= max || r->len - r->pos < n) { r->err = 1; dst[0] = '\0'; return; }
+    memcpy(dst, r->p + r->pos, n);
+    dst[n] = '\0';
+    r->pos += n;
+}
+
+// Rend durable la création ou la suppression d'un fichier dans son répertoire
+static void fsync_parent_dir(const char *path) {
+    char dir[4096];
+    const char *slash = strrchr(path, '/');
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path) + (slash == path), path);
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+static void wal_segment_path(uint64_t start, char *path, size_t len) {
+    snprintf(path, len, "%s.%016" PRIx64, g_cfg.wal_path, start);
+}
+
+static int u64_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Liste les fichiers <prefix>.<numéro sur digits chiffres hexadécimaux>, par numéro croissant
+// Retourne leur nombre (*out à libérer)
+static int list_numbered_files(const char *prefix, size_t digits, uint64_t **out) {
+    char dir[4096];
+    const char *slash = strrchr(prefix, '/');
+    const char *base = slash ? slash + 1 : prefix;
+    size_t blen = strlen(base);
+    int n = 0, cap = 0;
+
+    *out = NULL;
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - prefix) + (slash == prefix), prefix);
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        const char *name = e->d_name;
+        char *end;
+        if (strncmp(name, base, blen) != 0 || name[blen] != '.' || strlen(name + blen + 1) != digits) continue;
+        uint64_t num = strtoull(name + blen + 1, &end, 16);
+        if (*end != '\0') continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 16;
+            uint64_t *p = realloc(*out, sizeof(*p) * (size_t)cap);
+            if (!p) break;
+            *out = p;
+        }
+        (*out)[n++] = num;
+    }
+    closedir(d);
+
+    if (n > 1) qsort(*out, (size_t)n, sizeof(**out), u64_cmp);
+    return n;
+}
+
+// Liste les segments du journal présents sur disque, par LSN de début croissant
+// Retourne leur nombre (*out à libérer)
+static int wal_list_segments(uint64_t **out) {
+    return list_numbered_files(g_cfg.wal_path, 16, out);
+}
+
+// Un point de reprise ou un segment du journal existe : l'état sur disque fait foi
+static int wal_has_disk_state(void) {
+    uint64_t *segs;
+    struct stat st;
+    int n = wal_list_segments(&segs);
+    free(segs);
+    return n > 0 || stat(g_cfg.snapshot_path, &st) == 0;
+}
+
+// Ouvre (ou crée) le segment qui commence au LSN start pour ce processus
+static void wal_open_segment(uint64_t start) {
+    char path[4096];
+
+    if (g_wal_fd >= 0) close(g_wal_fd);
+    wal_segment_path(start, path, sizeof(path));
+    g_wal_fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    if (g_wal_fd < 0)
+        perror_exit("Erreur lors de l'ouverture du journal");
+    fsync_parent_dir(path);
+    g_wal_fd_segment = start;
+}
+
+static unsigned char *wal_ring_at(void) {
+    return (unsigned char*)g_shm + g_shm->wal_ring;
+}
+
+// Écrit sur disque tout ce qui a été ajouté au journal, wal_lock relâché pendant l'écriture
+// (les octets [wal_durable, wal_append) ne sont pas réécrits tant que wal_durable n'a pas avancé)
+// Une erreur d'écriture est fatale : répondre au client serait mentir sur la durabilité
+// Appelant : wal_lock verrouillé, pas d'écriture en cours
+static void wal_flush_locked(void) {
+    uint64_t from = g_shm->wal_durable;
+    uint64_t to = g_shm->wal_append;
+    uint64_t seg = g_shm->wal_segment;
+
+    g_shm->wal_flushing = 1;
+    g_shm->wal_flusher = getpid();
+    pthread_mutex_unlock(&g_shm->wal_lock);
+
+    if (g_wal_fd < 0 || g_wal_fd_segment != seg) wal_open_segment(seg);
+    unsigned char *ring = wal_ring_at();
+    for (uint64_t pos = from; pos < to;) {
+        size_t off = (size_t)(pos % WAL_RING_SIZE);
+        size_t n = WAL_RING_SIZE - off < to - pos ? WAL_RING_SIZE - off : (size_t)(to - pos);
+        ssize_t w = pwrite(g_wal_fd, ring + off, n, (off_t)(pos - seg));
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            perror_exit("Erreur d'écriture du journal");
+        }
+        pos += (uint64_t)w;
+    }
+    if (to > from && fdatasync(g_wal_fd) == -1)
+        perror_exit("Erreur de synchronisation du journal");
+
+    shm_mutex_lock(&g_shm->wal_lock);
+    __atomic_store_n(&g_shm->wal_durable, to, __ATOMIC_RELEASE);
+    g_shm->wal_flushing = 0;
+    __atomic_store_n(&g_shm->wal_wake, g_shm->wal_wake + 1, __ATOMIC_RELEASE);
+    futex_wake_all(&g_shm->wal_wake);
+}
+
+// Attend la fin de l'écriture en cours du journal. L'écrivain ne tient pas wal_lock
+// pendant l'écriture : s'il meurt, aucun verrou ne le signale. On vérifie donc
+// régulièrement qu'il est vivant, sinon sa place est libérée (l'écriture reprendra
+// depuis wal_durable, les mêmes octets aux mêmes positions).
+// Appelant : wal_lock verrouillé
+static void wal_wait_locked(void) {
+    uint32_t seen = g_shm->wal_wake;
+
+    pthread_mutex_unlock(&g_shm->wal_lock);
+    futex_wait_ms(&g_shm->wal_wake, seen, WAL_OWNER_CHECK_MS);
+    // Un détenteur de wal_lock mort n'a rien laissé à moitié : wal_append n'avance qu'une fois l'enregistrement copié
+    shm_mutex_lock(&g_shm->wal_lock);
+
+    if (g_shm->wal_flushing && !pid_alive(g_shm->wal_flusher)) {
+        fprintf(stderr, "Écriture du journal abandonnée par le processus %d : reprise\n", (int)g_shm->wal_flusher);
+        g_shm->wal_flushing = 0;
+    }
+}
+
+// Attend que le journal soit sur disque jusqu'au LSN lsn (en l'écrivant soi-même si personne ne le fait)
+static void wal_sync(uint64_t lsn) {
+    if (!g_cfg.wal_path || __atomic_load_n(&g_shm->wal_durable, __ATOMIC_ACQUIRE) >= lsn) return;
+
+    uint64_t t0 = t_stats ? now_ns() : 0;
+    shm_mutex_lock(&g_shm->wal_lock);
+    while (g_shm->wal_durable < lsn) {
+        if (!g_shm->wal_flushing) wal_flush_locked();
+        else wal_wait_locked();
+    }
+    pthread_mutex_unlock(&g_shm->wal_lock);
+    if (t_stats) {
+        uint64_t waited = now_ns() - t0;
+        stat_add(&t_stats->durable_waits, 1);
+        stat_add(&t_stats->durable_wait_ns, waited);
+        stat_max(&t_stats->durable_wait_max, waited);
+    }
+}
+
+// Commence un enregistrement : place réservée pour la longueur et le CRC
+static void wal_begin(wbuf_t *b, wal_type_t type) {
+    b->len = 8;
+    put_u8(b, (uint8_t)type);
+}
+
+// Ajoute l'enregistrement au journal. Appelé dans la section d'écriture de la donnée
+// modifiée : l'ordre des LSN suit l'ordre des modifications d'un même ticket.
+static void wal_append(wbuf_t *b) {
+    if (!g_cfg.wal_path) return;
+
+    uint32_t len = (uint32_t)b->len;
+    uint32_t crc = crc32_update(0, b->data + 8, b->len - 8);
+    memcpy(b->data, &len, sizeof(len));
+    memcpy(b->data + 4, &crc, sizeof(crc));
+
+    stat_lock(&g_shm->wal_lock, LOCK_WAL);
+    // Tampon plein : on attend (ou on fait) l'écriture des enregistrements précédents
+    while (g_shm->wal_append + len - g_shm->wal_durable > WAL_RING_SIZE) {
+        if (!g_shm->wal_flushing) wal_flush_locked();
+        else wal_wait_locked();
+    }
+    unsigned char *ring = wal_ring_at();
+    size_t off = (size_t)(g_shm->wal_append % WAL_RING_SIZE);
+    size_t first = WAL_RING_SIZE - off < len ? WAL_RING_SIZE - off : len;
+    memcpy(ring + off, b->data, first);
+    memcpy(ring, b->data + first, len - first);
+    g_shm->wal_append += len;
+    t_wal_lsn = g_shm->wal_append;
+    stat_unlock(&g_shm->wal_lock, LOCK_WAL);
+}
+
+// Contenu d'un ticket créé : ID, date, propriétaire, titre, description
+static void wal_log_insert(uint32_t id, time_t created, const char *owner, const char *title, const char *desc) {
+    wbuf_t b;
+    wal_begin(&b, WAL_INSERT);
+    put_u32(&b, id);
+    put_u64(&b, (uint64_t)created);
+    put_str(&b, owner, MAX_USER);
+    put_str(&b, title, MAX_TITLE);
+    put_str(&b, desc, MAX_DESC);
+    wal_append(&b);
+}
+
+static void wal_log_assign(uint32_t id, const char *tech) {
+    wbuf_t b;
+    wal_begin(&b, WAL_ASSIGN);
+    put_u32(&b, id);
+    put_str(&b, tech, MAX_USER);
+    wal_append(&b);
+}
+
+// Changement d'état sans autre donnée (WAL_CLOSE, WAL_ESCALATE)
+static void wal_log_state(wal_type_t type, uint32_t id) {
+    wbuf_t b;
+    wal_begin(&b, type);
+    put_u32(&b, id);
+    wal_append(&b);
+}
+
+// Segment d'archive publié : ses tickets ont quitté le stockage
+static void wal_log_archive(uint32_t seq, uint32_t count) {
+    wbuf_t b;
+    wal_begin(&b, WAL_ARCHIVE);
+    put_u32(&b, seq);
+    put_u32(&b, count);
+    wal_append(&b);
+}
+
+static void wal_log_feedback(uint64_t pos, const feedback_t *f) {
+    wbuf_t b;
+    wal_begin(&b, WAL_FEEDBACK);
+    put_u64(&b, pos);
+    put_str(&b, f->username, MAX_USER);
+    put_u32(&b, (uint32_t)f->note_reactivite);
+    put_u32(&b, (uint32_t)f->note_competence);
+    put_u32(&b, (uint32_t)f->note_satisfaction);
+    wal_append(&b);
+}
+
+/* -------------------
+ * Anneau des feedbacks : sans verrou, plusieurs producteurs et plusieurs lecteurs
+ * ------------------- */
+
+static feedback_slot_t *feedback_ring(void) {
+    return (feedback_slot_t*)((char*)g_shm + g_shm->feedback_ring);
+}
+
+// Remplace l'anneau par un anneau de cap cases en conservant les avis les plus récents
+// Appelé au démarrage (index_lock verrouillé), avant que les clients ne soient servis :
+// un producteur d'un autre processus encore actif écrirait dans l'ancien anneau
+static int feedback_ring_resize(uint32_t cap) {
+    uint64_t off = shm_alloc(sizeof(feedback_slot_t) * cap);
+    if (off == 0) return -1;
+
+    feedback_slot_t *ring = (feedback_slot_t*)((char*)g_shm + off);
+    uint64_t head = g_shm->feedback_head;
+    uint32_t old_cap = g_shm->feedback_cap;
+    uint64_t keep = old_cap < cap ? old_cap : cap;
+    for (uint64_t pos = head > keep ? head - keep : 0; pos < head; pos++) {
+        feedback_slot_t *src = &feedback_ring()[pos % old_cap];
+        if (src->seq != 2 * (pos + 1)) continue;
+        ring[pos % cap] = *src;
+    }
+    g_shm->feedback_ring = off;
+    g_shm->feedback_cap = cap;
+    return 0;
+}
+
+// Ajoute un feedback utilisateur : la case est réservée par incrément atomique
+// de feedback_head, puis publiée par son numéro de séquence
+static void add_feedback(const char *username, int n1, int n2, int n3) {
+    // Audité même si l'anneau des avis l'écrase aussitôt
+    audit_log(AUDIT_FEEDBACK, 0, username, (const int[3]){ n1, n2, n3 });
+
+    uint64_t pos = __atomic_fetch_add(&g_shm->feedback_head, 1, __ATOMIC_RELAXED);
+    feedback_slot_t *slot = &feedback_ring()[pos % g_shm->feedback_cap];
+    uint64_t done = 2 * (pos + 1);
+    uint64_t cur = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+    for (int spins = 0;; spins++) {
+        // Un producteur d'un tour suivant a déjà pris la case : notre avis serait écrasé
+        if (cur >= done) return;
+        // Écriture du tour précédent en cours (reprise si son auteur semble mort)
+        if ((cur & 1) && spins < FEEDBACK_SPIN_LIMIT) {
+            sched_yield();
+            cur = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&slot->seq, &cur, done - 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            break;
+    }
+
+    feedback_t *f = &slot->f;
+    memset(f->username, 0, sizeof(f->username));
+    snprintf(f->username, sizeof(f->username), "%s", username);
+    f->note_reactivite = n1;
+    f->note_competence = n2;
+    f->note_satisfaction = n3;
+
+    __atomic_store_n(&slot->seq, done, __ATOMIC_RELEASE);
+    wal_log_feedback(pos, f);
+}
+
+// Copie les avis encore présents, du plus ancien au plus récent, sans verrou :
+// une case en cours d'écriture ou réécrite pendant la copie est ignorée
+// Retourne le nombre d'avis copiés dans out (max cases)
+static uint32_t feedback_snapshot(feedback_t *out, uint32_t max) {
+    uint64_t head = __atomic_load_n(&g_shm->feedback_head, __ATOMIC_ACQUIRE);
+    uint32_t cap = g_shm->feedback_cap;
+    feedback_slot_t *ring = feedback_ring();
+    uint32_t n = 0;
+
+    for (uint64_t pos = head > cap ? head - cap : 0; pos < head && n < max; pos++) {
+        feedback_slot_t *slot = &ring[pos % cap];
+        uint64_t s = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (s != 2 * (pos + 1)) continue;
+        out[n] = slot->f;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != s) continue;
+        out[n].username[MAX_USER-1] = '\0';
+        n++;
+    }
+    return n;
+}
+
+/* -------------------
+ * Anneau des changements (commande watch) : chaque création, escalade, prise en charge et
+ * clôture y ajoute une case, numérotée par change_head. Les abonnés de tous les processus
+ * le lisent sans verrou, chacun depuis sa propre position ; une case réécrite entre-temps
+ * (abonné dépassé d'un tour) est détectée par son numéro de séquence.
+ * ------------------- */
+
+static change_t *change_ring(void) {
+    return (change_t*)((char*)g_shm + g_shm->change_ring);
+}
+
+// Le thread a publié des changements : les abonnés sont réveillés à index_unlock, hors du verrou
+static __thread int t_change_wake = 0;
+
+// Publie un changement : le ticket id vient de passer à l'état state
+// Appelant : index_lock verrouillé (un seul écrivain à la fois)
+static void change_publish(uint32_t id, ticket_state_t state, uint32_t tech_uid) {
+    uint64_t n = g_shm->change_head;
+    change_t *c = &change_ring()[n % CHANGE_RING_SIZE];
+
+    __atomic_store_n(&c->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    c->id = id;
+    c->state = (uint32_t)state;
+    c->tech_uid = tech_uid;
+    __atomic_store_n(&c->seq, 2 * (n + 1), __ATOMIC_RELEASE);
+    __atomic_store_n(&g_shm->change_head, n + 1, __ATOMIC_RELEASE);
+    t_change_wake = 1;
+}
+
+// Réveille les threads de suivi des processus, s'il y a des abonnés
+static void change_notify(void) {
+    // Ordonne la publication avant la lecture du nombre d'abonnés (voir watch_start)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_shm->watchers, __ATOMIC_RELAXED) == 0) return;
+    __atomic_add_fetch(&g_shm->change_wake, 1, __ATOMIC_RELEASE);
+    futex_wake_all(&g_shm->change_wake);
+}
+
+// Copie le changement n (n < change_head) sans verrou
+// Retourne -1 si sa case a déjà été réécrite
+static int change_read(uint64_t n, change_t *out) {
+    change_t *c = &change_ring()[n % CHANGE_RING_SIZE];
+    uint64_t s = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+
+    if (s != 2 * (n + 1)) return -1;
+    out->id = c->id;
+    out->state = c->state;
+    out->tech_uid = c->tech_uid;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&c->seq, __ATOMIC_RELAXED) == s ? 0 : -1;
+}
+
+// --- Initialisation de la mémoire partagée (si pas encore faite) ---
+static void shm_init_if_needed() {
+    // Si l'espace mémoire du mutex n'est pas dfinie
+    if (!g_shm) return;
+
+    // Lock le mutex (repris à un processus mort : les index seront refaits au prochain index_lock)
+    if (shm_mutex_lock(&g_shm->index_lock))
+        g_shm->repair_needed = 1;
+    if (!g_shm->initialized) {
+        // Réinitialise tout le contenu (les pages de tickets sont allouées à la demande)
+        g_shm->heap_top = (sizeof(shared_data_t) + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1);
+        g_shm->next_id = 1;
+        g_shm->slab_count = 0;
+        g_shm->slot_count = 0;
+        g_shm->free_head = 0;
+        g_shm->live_tickets = 0;
+        g_shm->id_index_cap = ID_INDEX_INITIAL;
+        g_shm->id_index_used = 0;
+        g_shm->id_index = shm_alloc(sizeof(id_index_entry_t) * ID_INDEX_INITIAL);
+        if (g_shm->id_index == 0)
+            perror_exit("Erreur lors de l'allocation de l'index des tickets");
+        memset(g_shm->state_lists, 0, sizeof(g_shm->state_lists));
+        g_shm->user_index_cap = USER_INDEX_INITIAL;
+        g_shm->user_count = 0;
+        g_shm->user_index = shm_alloc(sizeof(uint32_t) * USER_INDEX_INITIAL);
+        if (g_shm->user_index == 0)
+            perror_exit("Erreur lors de l'allocation de l'annuaire des utilisateurs");
+        g_shm->feedback_head = 0;
+        g_shm->feedback_cap = 0;
+        g_shm->change_ring = shm_alloc(sizeof(change_t) * CHANGE_RING_SIZE);
+        if (g_shm->change_ring == 0)
+            perror_exit("Erreur lors de l'allocation de l'anneau des changements");
+        g_shm->change_head = 0;
+        g_shm->watchers = 0;
+        g_shm->tech_online = shm_alloc(sizeof(tech_online_t) * TECH_TABLE_INITIAL);
+        g_shm->tech_heap = shm_alloc(sizeof(uint32_t) * TECH_TABLE_INITIAL);
+        if (g_shm->tech_online == 0 || g_shm->tech_heap == 0)
+            perror_exit("Erreur lors de l'allocation de la table des techniciens");
+        g_shm->tech_online_cap = g_shm->tech_heap_cap = TECH_TABLE_INITIAL;
+        g_shm->tech_online_used = g_shm->tech_online_count = g_shm->tech_heap_len = 0;
+        g_shm->wal_ring = shm_alloc(WAL_RING_SIZE);
+        if (g_shm->wal_ring == 0)
+            perror_exit("Erreur lors de l'allocation du tampon du journal");
+        g_shm->wal_append = g_shm->wal_durable = g_shm->wal_segment = 0;
+        g_shm->wal_flushing = 0;
+        g_shm->repair_needed = 0;
+        g_shm->ckpt_lsn = 0;
+        g_shm->ckpt_time = time(NULL);
+        g_shm->text_chunk = g_shm->text_used = 0;
+        g_shm->stats = shm_alloc(sizeof(stats_block_t) * STATS_SLOTS);
+        if (g_shm->stats == 0)
+            perror_exit("Erreur lors de l'allocation des statistiques");
+        g_shm->search_cap = SEARCH_INDEX_INITIAL;
+        g_shm->search_used = 0;
+        g_shm->search_bytes = 0;
+        g_shm->search_index = shm_alloc(sizeof(search_term_t) * SEARCH_INDEX_INITIAL);
+        if (g_shm->search_index == 0)
+            perror_exit("Erreur lors de l'allocation de l'index de recherche");
+        g_shm->archive_segments = shm_alloc(sizeof(archive_segment_t) * ARCHIVE_MAX_SEGMENTS);
+        if (g_shm->archive_segments == 0)
+            perror_exit("Erreur lors de l'allocation de la table des archives");
+        g_shm->archive_count = g_shm->archive_next = 0;
+        g_shm->archive_tickets = g_shm->archive_bytes = 0;
+        g_shm->initialized = 1;
+    }
+
+    // Capacité de l'anneau des avis choisie au démarrage
+    if (g_shm->feedback_cap != g_cfg.feedback_capacity && feedback_ring_resize(g_cfg.feedback_capacity) != 0)
+        perror_exit("Erreur lors de l'allocation de l'anneau des avis");
+
+    // Unlock le mutex
+    pthread_mutex_unlock(&g_shm->index_lock);
+}
+
+// Remet le fichier mappé à zéro : taille initiale, verrous partagés réinitialisés
+static void shm_format(int fd) {
+    // Remise à zéro puis taille initiale
+    if (ftruncate(fd, 0) == -1 || ftruncate(fd, SHM_INITIAL_SIZE) == -1)
+        perror_exit("Erreur lors du troncage de la mémoire partagée");
+
+    // --- Initialisation des mutex partagés entre processus ---
+    pthread_mutexattr_t mattr;
+
+    // Initialisation des attributs du mutex
+    if (pthread_mutexattr_init(&mattr) != 0)
+        perror_exit("Erreur lors de l'initialisation des attributs du mutex");
+    
+    // Attribut du mutex partagé entre les thread
+    if (pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED) != 0)
+        perror_exit("Erreur lors de l'attribution de l'espace partagé");
+
+    // Robustes : un processus mort avec un verrou ne bloque pas les autres
+    if (pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST) != 0)
+        perror_exit("Erreur lors de l'attribution de la robustesse des mutex");
+
+    // Initialisation des mutex avec les attributs
+    int rc = pthread_mutex_init(&g_shm->index_lock, &mattr);
+    for (int i = 0; i < LOCK_STRIPES; i++)
+        rc |= pthread_mutex_init(&g_shm->slot_locks[i].m, &mattr);
+    rc |= pthread_mutex_init(&g_shm->wal_lock, &mattr);
+    rc |= pthread_mutex_init(&g_shm->ckpt_lock, &mattr);
+    rc |= pthread_mutex_init(&g_shm->archive_lock, &mattr);
+    if (rc != 0) 
+        perror_exit("Erreur lors de l'initialisation des mutex partagés");
+    
+    pthread_mutexattr_destroy(&mattr);
+    g_shm->file_size = SHM_INITIAL_SIZE;
+    g_shm->initialized = 0; // Marque non initialisé au niveau applicatif
+    g_shm->magic = SHM_MAGIC;
+}
+
+// --- Création/attachement de la mémoire partagée ---
+// Le fichier est mappé une seule fois sur SHM_RESERVE octets d'espace d'adressage :
+// l'agrandir par ftruncate rend les nouvelles pages accessibles dans tous les processus
+// sans remappage, donc sans invalider les pointeurs en cours d'utilisation.
+// Le verrou de démarrage (flock) reste pris : shm_startup_done le relâche une fois
+// la reprise éventuelle terminée.
+// Retourne 1 si aucun autre processus n'utilise le stockage
+static int shm_open_map() {
+    int fd;
+    struct stat st;
+
+    //fd = shm_open(SHM_NAME, O_RDWR | O_CREAT, 0600); // Ouvre ou crée la mémoire partagée
+    fd = open(g_cfg.shm_path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) 
+        perror_exit("Erreur lors de l'ouverture de la mémoire partagée");
+
+    // Un seul processus à la fois démarre (formatage, reprise)
+    if (flock(fd, LOCK_EX) == -1)
+        perror_exit("Erreur lors du verrouillage de la mémoire partagée");
+    if (fstat(fd, &st) == -1)
+        perror_exit("Erreur lors de la lecture de la taille de la mémoire partagée");
+
+    void *addr = mmap(NULL, SHM_RESERVE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0); // Mappe dans l’espace mémoire
+    if (addr == MAP_FAILED) 
+        perror_exit("Erreur lors du mappage");
+
+    g_shm = (shared_data_t*)addr;
+    g_shm_fd = fd;
+
+    // Verrou de présence sur le premier octet : partagé par chaque processus en marche,
+    // l'obtenir en exclusif signifie qu'on est seul
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_len = 1;
+    int alone = fcntl(fd, F_OFD_SETLK, &fl) == 0;
+
+    // Fichier vierge ou d'un ancien format, ou état à reconstruire depuis le journal : on le reformate
+    if ((size_t)st.st_size < sizeof(shared_data_t) || g_shm->magic != SHM_MAGIC ||
+        (alone && g_cfg.wal_path && wal_has_disk_state()))
+        shm_format(fd);
+
+    shm_init_if_needed(); // Termine l’initialisation logique
+    return alone;
+}
+
+// Fin du démarrage : le processus signale sa présence et laisse démarrer les suivants
+static void shm_startup_done(void) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_len = 1;
+    if (fcntl(g_shm_fd, F_OFD_SETLKW, &fl) == -1)
+        perror_exit("Erreur lors du verrouillage de la mémoire partagée");
+    flock(g_shm_fd, LOCK_UN);
+}
+
+/* -------------------
+ * Fonctions de gestion des tickets
+ * ------------------- */
+
+// Partie chaude du ticket stocké dans le slot donné
+static ticket_hot_t *ticket_at(uint32_t slot) {
+    return (ticket_hot_t*)((char*)g_shm + g_shm->slabs[slot / SLAB_TICKETS]) + slot % SLAB_TICKETS;
+}
+
+static const char *text_title(const ticket_text_t *x) {
+    return x->data;
+}
+
+static const char *text_desc(const ticket_text_t *x) {
+    return x->data + x->title_len + 1;
+}
+
+// Copie le texte d'un ticket dans l'arène ; les chaînes sont tronquées comme l'étaient
+// les champs de taille fixe. Le texte n'est jamais libéré : une reprise reconstruit
+// le stockage et compacte l'arène.
+// Retourne son offset, ou 0 si le stockage est plein
+// Appelant : index_lock verrouillé
+static uint64_t ticket_text_store(const char *title, const char *desc) {
+    size_t lt = strnlen(title, MAX_TITLE-1), ld = strnlen(desc, MAX_DESC-1);
+    uint64_t size = (sizeof(ticket_text_t) + lt + ld + 2 + 7) & ~(uint64_t)7;
+
+    if (g_shm->text_chunk == 0 || g_shm->text_used + size > TEXT_CHUNK) {
+        uint64_t chunk = shm_alloc(TEXT_CHUNK);
+        if (chunk == 0) return 0;
+        g_shm->text_chunk = chunk;
+        g_shm->text_used = 0;
+    }
+    uint64_t off = g_shm->text_chunk + g_shm->text_used;
+    g_shm->text_used += size;
+
+    ticket_text_t *x = (ticket_text_t*)((char*)g_shm + off);
+    x->title_len = (uint16_t)lt;
+    x->desc_len = (uint16_t)ld;
+    char *d = x->data;
+    memcpy(d, title, lt); d += lt; *d++ = '\0';
+    memcpy(d, desc, ld); d[ld] = '\0';
+    return off;
+}
+
+/* -------------------
+ * Synchronisation : seqlocks et verrous par tranche
+ * ------------------- */
+
+// Début d'écriture : le compteur devient impair (l'écrivain est seul, sous verrou)
+static void seq_write_begin(uint32_t *seq) {
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// Fin d'écriture : le compteur redevient pair et publie les modifications
+static void seq_write_end(uint32_t *seq) {
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+// Début de lecture : retourne la valeur observée (impaire = écriture en cours)
+static uint32_t seq_read_begin(const uint32_t *seq) {
+    return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+// Fin de lecture : vrai si la lecture doit être recommencée
+static int seq_read_retry(const uint32_t *seq, uint32_t start) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (start & 1) || __atomic_load_n(seq, __ATOMIC_RELAXED) != start;
+}
+
+// Tranche reprise à un processus mort : un de ses tickets a pu rester en cours
+// d'écriture (compteur impair), il redevient lisible. Les index et compteurs qui en
+// dépendent sont refaits par le prochain détenteur d'index_lock.
+// Appelant : verrou de la tranche pris
+static void stripe_repair(uint32_t stripe) {
+    uint32_t count = __atomic_load_n(&g_shm->slot_count, __ATOMIC_ACQUIRE);
+
+    for (uint32_t slot = stripe; slot < count; slot += LOCK_STRIPES) {
+        ticket_hot_t *t = ticket_at(slot);
+        if (t->seq & 1) seq_write_end(&t->seq);
+    }
+    __atomic_store_n(&g_shm->repair_needed, 1, __ATOMIC_RELEASE);
+}
+
+// Ouvre une écriture du contenu du ticket : verrou de sa tranche puis seqlock
+static void ticket_write_begin(uint32_t slot) {
+    if (stat_lock(&g_shm->slot_locks[slot % LOCK_STRIPES].m, LOCK_STRIPE))
+        stripe_repair(slot % LOCK_STRIPES);
+    seq_write_begin(&ticket_at(slot)->seq);
+}
+
+static void ticket_write_end(uint32_t slot) {
+    seq_write_end(&ticket_at(slot)->seq);
+    stat_unlock(&g_shm->slot_locks[slot % LOCK_STRIPES].m, LOCK_STRIPE);
+}
+
+
+/* -------------------
+ * Index ID -> slot (table de hachage à adressage ouvert dans le mappage)
+ * ------------------- */
+
+static id_index_entry_t *id_index_table(void) {
+    return (id_index_entry_t*)((char*)g_shm + g_shm->id_index);
+}
+
+// Hachage multiplicatif : les ID consécutifs sont dispersés dans la table
+static uint32_t id_hash(uint32_t id) {
+    return id * 0x9E3779B1u;
+}
+
+// Retourne le slot du ticket id, ou -1 s'il n'est pas indexé
+// Utilisable sans verrou à condition de revérifier l'ID du slot sous son verrou :
+// le sondage est borné par la taille lue avant la table (voir id_index_reserve)
+static int64_t id_index_find(uint32_t id) {
+    uint32_t cap = __atomic_load_n(&g_shm->id_index_cap, __ATOMIC_ACQUIRE);
+    uint64_t off = __atomic_load_n(&g_shm->id_index, __ATOMIC_ACQUIRE);
+    id_index_entry_t *tab = (id_index_entry_t*)((char*)g_shm + off);
+    uint32_t mask = cap - 1;
+    uint32_t i = id_hash(id) & mask;
+
+    for (uint32_t n = 0; n < cap; n++, i = (i + 1) & mask) {
+        if (tab[i].id == id) return tab[i].slot;
+        if (tab[i].id == 0) return -1;
+    }
+    return -1;
+}
+
+// Insère sans vérifier la capacité (id_index_reserve doit avoir été appelé)
+static void id_index_put(id_index_entry_t *tab, uint32_t cap, uint32_t id, uint32_t slot) {
+    uint32_t mask = cap - 1;
+    uint32_t i = id_hash(id) & mask;
+
+    while (tab[i].id != 0 && tab[i].id != ID_TOMBSTONE)
+        i = (i + 1) & mask;
+    tab[i].id = id;
+    tab[i].slot = slot;
+}
+
+// Garantit la place pour une insertion (facteur de charge ≤ 0.7, tombes comprises)
+// en reconstruisant la table si besoin. L'ancienne table reste dans le tas :
+// il n'y a pas de réutilisation des zones, le coût total reste borné par la taille finale.
+// Retourne -1 si le stockage est plein
+static int id_index_reserve(void) {
+    uint32_t cap = g_shm->id_index_cap;
+
+    if ((uint64_t)(g_shm->id_index_used + 1) * 10 < (uint64_t)cap * 7) return 0;
+
+    // Double la taille sauf si la table est surtout remplie de tombes
+    uint32_t newcap = (uint64_t)(g_shm->live_tickets + 1) * 10 < (uint64_t)cap * 3 ? cap : cap * 2;
+    uint64_t off = shm_alloc(sizeof(id_index_entry_t) * newcap);
+    if (off == 0) return -1;
+
+    id_index_entry_t *old = id_index_table();
+    id_index_entry_t *tab = (id_index_entry_t*)((char*)g_shm + off);
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < cap; i++) {
+        if (old[i].id != 0 && old[i].id != ID_TOMBSTONE) {
+            id_index_put(tab, newcap, old[i].id, old[i].slot);
+            used++;
+        }
+    }
+    // L'écrivain publie l'offset puis la taille ; un lecteur sans verrou lit la taille puis
+    // l'offset (tous deux en acquire) : la table qu'il lit est au moins aussi grande que la
+    // taille qu'il a vue
+    if (newcap > cap) {
+        __atomic_store_n(&g_shm->id_index, off, __ATOMIC_RELEASE);
+        __atomic_store_n(&g_shm->id_index_cap, newcap, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&g_shm->id_index, off, __ATOMIC_RELEASE);
+    }
+    g_shm->id_index_used = used;
+    return 0;
+}
+
+static void id_index_insert(uint32_t id, uint32_t slot) {
+    id_index_put(id_index_table(), g_shm->id_index_cap, id, slot);
+    g_shm->id_index_used++;
+}
+
+// Remplace l'entrée par une tombe pour ne pas casser les chaînes de sondage
+static void id_index_remove(uint32_t id) {
+    id_index_entry_t *tab = id_index_table();
+    uint32_t mask = g_shm->id_index_cap - 1;
+
+    for (uint32_t i = id_hash(id) & mask; tab[i].id != 0; i = (i + 1) & mask) {
+        if (tab[i].id == id) {
+            tab[i].id = ID_TOMBSTONE;
+            return;
+        }
+    }
+}
+
+/* -------------------
+ * Annuaire des utilisateurs (nom -> entrée) et listes intrusives de tickets
+ * ------------------- */
+
+static user_entry_t *user_at(uint32_t uid) {
+    return (user_entry_t*)((char*)g_shm + g_shm->user_pages[uid / USER_PAGE]) + uid % USER_PAGE;
+}
+
+static uint32_t *user_index_table(void) {
+    return (uint32_t*)((char*)g_shm + g_shm->user_index);
+}
+
+// FNV-1a
+static uint32_t name_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) { h ^= (unsigned char)*s++; h *= 16777619u; }
+    return h;
+}
+
+// Retourne l'uid de l'utilisateur name, ou -1 s'il est inconnu
+// Sans verrou, la recherche recommence tant que l'annuaire est en cours de modification
+static int64_t user_find(const char *name) {
+    uint32_t h = name_hash(name);
+
+    while (1) {
+        uint32_t s = seq_read_begin(&g_shm->dir_seq);
+        uint32_t *tab = user_index_table();
+        uint32_t cap = g_shm->user_index_cap;
+        uint32_t mask = cap - 1;
+        int64_t found = -1;
+
+        uint32_t i = h & mask;
+        for (uint32_t n = 0; n < cap && tab[i] != 0; n++, i = (i + 1) & mask) {
+            uint32_t uid = tab[i] - 1;
+            if (uid < g_shm->user_count && strncmp(user_at(uid)->name, name, MAX_USER) == 0) {
+                found = uid;
+                break;
+            }
+        }
+        if (!seq_read_retry(&g_shm->dir_seq, s)) return found;
+        sched_yield();
+    }
+}
+
+// Insère sans vérifier la capacité
+static void user_index_put(uint32_t *tab, uint32_t cap, uint32_t uid) {
+    uint32_t i = name_hash(user_at(uid)->name) & (cap - 1);
+    while (tab[i] != 0) i = (i + 1) & (cap - 1);
+    tab[i] = uid + 1;
+}
+
+// Retourne l'uid de l'utilisateur name, en le créant si besoin (-1 si le stockage est plein)
+// Appelant : index_lock verrouillé
+static int64_t user_intern(const char *name) {
+    int64_t uid = user_find(name);
+    if (uid >= 0) return uid;
+
+    uint32_t n = g_shm->user_count;
+    uint32_t cap = g_shm->user_index_cap;
+    uint64_t page = 0, index = 0;
+
+    // Nouvelle page d'entrées (les pages existantes ne bougent jamais)
+    if (n % USER_PAGE == 0) {
+        if (n / USER_PAGE == MAX_USER_PAGES) return -1;
+        page = shm_alloc(sizeof(user_entry_t) * USER_PAGE);
+        if (page == 0) return -1;
+    }
+    // Table de hachage remplie à moitié : reconstruite deux fois plus grande
+    if ((n + 1) * 2 > cap) {
+        index = shm_alloc(sizeof(uint32_t) * cap * 2);
+        if (index == 0) return -1;
+    }
+
+    seq_write_begin(&g_shm->dir_seq);
+    if (page) g_shm->user_pages[n / USER_PAGE] = page;
+    user_entry_t *u = user_at(n);
+    memset(u, 0, sizeof(*u));
+    strncpy(u->name, name, MAX_USER-1);
+    if (index) {
+        uint32_t *tab = (uint32_t*)((char*)g_shm + index);
+        for (uint32_t i = 0; i < n; i++) user_index_put(tab, cap * 2, i);
+        g_shm->user_index = index;
+        g_shm->user_index_cap = cap * 2;
+    }
+    user_index_put(user_index_table(), g_shm->user_index_cap, n);
+    g_shm->user_count = n + 1;
+    seq_write_end(&g_shm->dir_seq);
+    return n;
+}
+
+// Copie des champs modifiables du ticket (sous seqlock ou verrou)
+static void ticket_copy_mutable(uint32_t slot, ticket_t *out, uint64_t *text) {
+    ticket_hot_t *t = ticket_at(slot);
+
+    out->id = t->id;
+    out->state = t->state;
+    out->created = t->created;
+    out->owner_uid = t->owner_uid;
+    out->tech_uid = t->tech_uid;
+    *text = t->text;
+}
+
+// Copie cohérente du ticket sans verrou ; après SEQ_READ_RETRIES échecs
+// (écrivain très actif), la copie se fait sous le verrou de la tranche.
+// Le texte, immuable et jamais libéré, est copié après coup depuis l'arène,
+// les noms depuis l'annuaire (les entrées ne bougent pas).
+static void ticket_read(uint32_t slot, ticket_t *out) {
+    ticket_hot_t *t = ticket_at(slot);
+    uint64_t text = 0;
+    int done = 0;
+
+    // En mode verrou global, l'appelant tient index_lock et tous les écrivains aussi
+    if (g_cfg.global_lock) {
+        ticket_copy_mutable(slot, out, &text);
+        done = 1;
+    }
+    for (int i = 0; !done && i < SEQ_READ_RETRIES; i++) {
+        uint32_t s = seq_read_begin(&t->seq);
+        ticket_copy_mutable(slot, out, &text);
+        done = !seq_read_retry(&t->seq, s);
+    }
+    if (!done) {
+        if (stat_lock(&g_shm->slot_locks[slot % LOCK_STRIPES].m, LOCK_STRIPE))
+            stripe_repair(slot % LOCK_STRIPES);
+        ticket_copy_mutable(slot, out, &text);
+        stat_unlock(&g_shm->slot_locks[slot % LOCK_STRIPES].m, LOCK_STRIPE);
+    }
+
+    if (out->id == 0 || text == 0) {
+        out->owner[0] = out->technician[0] = out->title[0] = out->desc[0] = '\0';
+        return;
+    }
+    memcpy(out->owner, user_at(out->owner_uid)->name, MAX_USER);
+    if (out->tech_uid) memcpy(out->technician, user_at(out->tech_uid - 1)->name, MAX_USER);
+    else out->technician[0] = '\0';
+    const ticket_text_t *x = (const ticket_text_t*)((const char*)g_shm + text);
+    memcpy(out->title, text_title(x), x->title_len + 1);
+    memcpy(out->desc, text_desc(x), x->desc_len + 1);
+}
+
+// Chaînage d'un ticket dans la liste désignée par l'offset du champ dans ticket_hot_t
+static list_link_t *ticket_link(uint32_t slot, size_t link_off) {
+    return (list_link_t*)((char*)ticket_at(slot) + link_off);
+}
+
+// Liste des tickets d'un état (chaînage state_link)
+static list_head_t *state_list(ticket_state_t state) {
+    return &g_shm->state_lists[state];
+}
+
+// Ajoute le ticket en fin de liste
+static void list_append(list_head_t *h, uint32_t slot, size_t link_off) {
+    list_link_t *l = ticket_link(slot, link_off);
+
+    seq_write_begin(&h->seq);
+    l->prev = h->tail;
+    l->next = 0;
+    if (h->tail) ticket_link(h->tail - 1, link_off)->next = slot + 1;
+    else h->head = slot + 1;
+    h->tail = slot + 1;
+    h->count++;
+    seq_write_end(&h->seq);
+}
+
+// Insère le ticket à sa place dans une liste triée par ID (parcours depuis la fin)
+static void list_insert_sorted(list_head_t *h, uint32_t slot, size_t link_off) {
+    uint32_t id = ticket_at(slot)->id;
+    uint32_t after = h->tail;
+
+    while (after != 0 && ticket_at(after - 1)->id > id)
+        after = ticket_link(after - 1, link_off)->prev;
+
+    list_link_t *l = ticket_link(slot, link_off);
+    seq_write_begin(&h->seq);
+    l->prev = after;
+    l->next = after ? ticket_link(after - 1, link_off)->next : h->head;
+    if (l->next) ticket_link(l->next - 1, link_off)->prev = slot + 1;
+    else h->tail = slot + 1;
+    if (after) ticket_link(after - 1, link_off)->next = slot + 1;
+    else h->head = slot + 1;
+    h->count++;
+    seq_write_end(&h->seq);
+}
+
+// Retire le ticket de la liste
+static void list_remove(list_head_t *h, uint32_t slot, size_t link_off) {
+    list_link_t *l = ticket_link(slot, link_off);
+
+    seq_write_begin(&h->seq);
+    if (l->prev) ticket_link(l->prev - 1, link_off)->next = l->next;
+    else h->head = l->next;
+    if (l->next) ticket_link(l->next - 1, link_off)->prev = l->prev;
+    else h->tail = l->prev;
+    l->prev = l->next = 0;
+    h->count--;
+    seq_write_end(&h->seq);
+}
+
+/* -------------------
+ * Techniciens connectés et disponibles (répartition des tickets) : chaque session de
+ * technicien occupe une case de tech_online (processus, uid) ; les techniciens connectés
+ * qui ont encore de la place forment un tas dans le mappage, le moins chargé (tickets
+ * IN_PROGRESS) en tête. Tout est modifié sous index_lock.
+ * ------------------- */
+
+static tech_online_t *tech_online(void) {
+    return (tech_online_t*)((char*)g_shm + g_shm->tech_online);
+}
+
+static uint32_t *tech_heap(void) {
+    return (uint32_t*)((char*)g_shm + g_shm->tech_heap);
+}
+
+static uint32_t tech_capacity(const user_entry_t *u) {
+    return u->capacity ? u->capacity : g_cfg.tech_capacity;
+}
+
+// Ordre du tas : charge croissante, puis uid
+static int tech_before(uint32_t a, uint32_t b) {
+    uint32_t la = user_at(a)->in_progress, lb = user_at(b)->in_progress;
+    return la != lb ? la < lb : a < b;
+}
+
+static void tech_heap_set(uint32_t i, uint32_t uid) {
+    tech_heap()[i] = uid;
+    user_at(uid)->heap_pos = i + 1;
+}
+
+// Replace le technicien de la case i (sa charge a changé)
+static void tech_heap_sift(uint32_t i) {
+    uint32_t *h = tech_heap();
+    uint32_t uid = h[i], len = g_shm->tech_heap_len;
+
+    while (i > 0 && tech_before(uid, h[(i - 1) / 2])) {
+        tech_heap_set(i, h[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= len) break;
+        if (c + 1 < len && tech_before(h[c + 1], h[c])) c++;
+        if (!tech_before(h[c], uid)) break;
+        tech_heap_set(i, h[c]);
+        i = c;
+    }
+    tech_heap_set(i, uid);
+}
+
+// Met le technicien à sa place après un changement de charge, de capacité ou de connexion :
+// dans le tas s'il est connecté et a encore de la place, hors du tas sinon
+// Appelant : index_lock verrouillé
+static void tech_update(uint32_t uid) {
+    user_entry_t *u = user_at(uid);
+    int avail = u->online > 0 && u->in_progress < tech_capacity(u);
+
+    if (avail && !u->heap_pos) {
+        // Tas plein : remplacé par un deux fois plus grand (stockage plein : pas de répartition pour lui)
+        if (g_shm->tech_heap_len == g_shm->tech_heap_cap) {
+            uint64_t off = shm_alloc(sizeof(uint32_t) * g_shm->tech_heap_cap * 2);
+            if (off == 0) return;
+            memcpy((char*)g_shm + off, tech_heap(), sizeof(uint32_t) * g_shm->tech_heap_len);
+            g_shm->tech_heap = off;
+            g_shm->tech_heap_cap *= 2;
+        }
+        tech_heap()[g_shm->tech_heap_len++] = uid;
+        tech_heap_sift(g_shm->tech_heap_len - 1);
+    } else if (!avail && u->heap_pos) {
+        uint32_t i = u->heap_pos - 1, last = tech_heap()[--g_shm->tech_heap_len];
+        u->heap_pos = 0;
+        if (i < g_shm->tech_heap_len) {
+            tech_heap_set(i, last);
+            tech_heap_sift(i);
+        }
+    } else if (avail) {
+        tech_heap_sift(u->heap_pos - 1);
+    }
+}
+
+// Enregistre une session du technicien uid
+// Retourne sa case + 1, 0 si la table ne peut pas grandir (stockage plein)
+// Appelant : index_lock verrouillé
+static uint32_t tech_online_add(uint32_t uid) {
+    uint32_t i = 0;
+
+    while (i < g_shm->tech_online_used && tech_online()[i].pid != 0) i++;
+    if (i == g_shm->tech_online_cap) {
+        uint64_t off = shm_alloc(sizeof(tech_online_t) * g_shm->tech_online_cap * 2);
+        if (off == 0) return 0;
+        memcpy((char*)g_shm + off, tech_online(), sizeof(tech_online_t) * g_shm->tech_online_used);
+        g_shm->tech_online = off;
+        g_shm->tech_online_cap *= 2;
+    }
+    if (i == g_shm->tech_online_used) g_shm->tech_online_used++;
+    tech_online()[i].pid = getpid();
+    tech_online()[i].uid = uid;
+    g_shm->tech_online_count++;
+    user_at(uid)->online++;
+    tech_update(uid);
+    return i + 1;
+}
+
+// Fin d'une session de technicien (case + 1 rendue par tech_online_add)
+// Appelant : index_lock verrouillé
+static void tech_online_remove(uint32_t slot) {
+    tech_online_t *e = &tech_online()[slot - 1];
+
+    e->pid = 0;
+    g_shm->tech_online_count--;
+    user_at(e->uid)->online--;
+    tech_update(e->uid);
+}
+
+// Recompte les sessions connectées, sans celles des processus morts, puis refait le tas
+// (démarrage d'un worker, reconstruction des index : les charges ont pu changer)
+// Appelant : index_lock verrouillé
+static void tech_rebuild(void) {
+    tech_online_t *tab = tech_online();
+
+    for (uint32_t uid = 0; uid < g_shm->user_count; uid++) {
+        user_at(uid)->online = 0;
+        user_at(uid)->heap_pos = 0;
+    }
+    g_shm->tech_heap_len = 0;
+    g_shm->tech_online_count = 0;
+    for (uint32_t i = 0; i < g_shm->tech_online_used; i++) {
+        if (tab[i].pid == 0) continue;
+        if (!pid_alive(tab[i].pid) || tab[i].uid >= g_shm->user_count) {
+            tab[i].pid = 0;
+            continue;
+        }
+        g_shm->tech_online_count++;
+        user_at(tab[i].uid)->online++;
+    }
+    for (uint32_t i = 0; i < g_shm->tech_online_used; i++)
+        if (tab[i].pid != 0) tech_update(tab[i].uid);
+}
+
+/* -------------------
+ * Index de recherche : terme -> tickets dont le titre ou la description le contient.
+ * Le dictionnaire est une table à adressage ouvert dans le mappage ; la liste d'un terme
+ * ne fait que s'allonger (chaque création ajoute un ID plus grand que les précédents)
+ * et ses octets déjà écrits ne changent plus : une recherche relève les listes sous
+ * search_seq puis les décode sans verrou. Les tickets disparus restent dans les listes,
+ * la recherche les écarte en consultant l'index ID -> slot.
+ * ------------------- */
+
+static search_term_t *search_table(void) {
+    return (search_term_t*)((char*)g_shm + g_shm->search_index);
+}
+
+// Lettre ou chiffre ASCII, ou octet d'un caractère UTF-8 (accents gardés tels quels)
+static int search_is_word(unsigned char c) {
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c >= 0x80;
+}
+
+// Lit le terme suivant de p dans term (SEARCH_TERM_MAX octets complétés par des '\0'),
+// en minuscules ASCII ; les termes de moins de SEARCH_TERM_MIN octets sont sautés
+// Retourne la position après le terme, ou NULL s'il n'y en a plus
+static const char *search_next_term(const char *p, char *term) {
+    while (1) {
+        while (*p && !search_is_word((unsigned char)*p)) p++;
+        if (!*p) return NULL;
+
+        size_t n = 0;
+        memset(term, 0, SEARCH_TERM_MAX);
+        for (; search_is_word((unsigned char)*p); p++) {
+            char c = *p >= 'A' && *p <= 'Z' ? (char)(*p + ('a' - 'A')) : *p;
+            if (n < SEARCH_TERM_MAX - 1) term[n++] = c;
+        }
+        if (n >= SEARCH_TERM_MIN) return p;
+    }
+}
+
+// Case du terme dans la table : la sienne, ou la case libre où l'insérer
+static search_term_t *search_slot(search_term_t *tab, uint32_t cap, const char *term) {
+    uint32_t i = name_hash(term) & (cap - 1);
+    while (tab[i].term[0] != '\0' && memcmp(tab[i].term, term, SEARCH_TERM_MAX) != 0)
+        i = (i + 1) & (cap - 1);
+    return &tab[i];
+}
+
+// Retourne l'entrée du terme, ou NULL s'il n'est pas indexé
+// Sans verrou sous search_seq : la taille est lue avant la table, le sondage est borné
+static const search_term_t *search_find(const char *term) {
+    uint32_t cap = __atomic_load_n(&g_shm->search_cap, __ATOMIC_ACQUIRE);
+    const search_term_t *tab = search_table();
+    uint32_t i = name_hash(term) & (cap - 1);
+
+    for (uint32_t n = 0; n < cap && tab[i].term[0] != '\0'; n++, i = (i + 1) & (cap - 1))
+        if (memcmp(tab[i].term, term, SEARCH_TERM_MAX) == 0) return &tab[i];
+    return NULL;
+}
+
+// Retourne l'entrée du terme, créée si besoin (NULL si le stockage est plein)
+// Appelant : index_lock verrouillé, search_seq impair
+static search_term_t *search_intern(const char *term) {
+    uint32_t cap = g_shm->search_cap;
+
+    // Table remplie à 70 % : reconstruite deux fois plus grande (l'ancienne n'est pas rendue)
+    if ((uint64_t)(g_shm->search_used + 1) * 10 > (uint64_t)cap * 7) {
+        uint64_t off = shm_alloc(sizeof(search_term_t) * cap * 2);
+        if (off == 0) return NULL;
+        search_term_t *old = search_table();
+        search_term_t *tab = (search_term_t*)((char*)g_shm + off);
+        for (uint32_t i = 0; i < cap; i++)
+            if (old[i].term[0] != '\0') *search_slot(tab, cap * 2, old[i].term) = old[i];
+        g_shm->search_index = off;
+        __atomic_store_n(&g_shm->search_cap, cap * 2, __ATOMIC_RELEASE);
+    }
+
+    search_term_t *e = search_slot(search_table(), g_shm->search_cap, term);
+    if (e->term[0] == '\0') {
+        memcpy(e->term, term, SEARCH_TERM_MAX);
+        g_shm->search_used++;
+    }
+    return e;
+}
+
+// Ajoute id (plus grand que le dernier ID de la liste) à la liste du terme
+// Retourne -1 si le stockage est plein
+// Appelant : index_lock verrouillé, search_seq impair
+static int search_postings_add(search_term_t *e, uint32_t id) {
+    // Place pour un varint de 32 bits (5 octets) ; l'ancienne liste reste lisible
+    if (e->cap - e->bytes < 5) {
+        uint32_t cap = e->cap ? e->cap * 2 : SEARCH_POSTINGS_INITIAL;
+        uint64_t off = shm_alloc(cap);
+        if (off == 0) return -1;
+        memcpy((char*)g_shm + off, (char*)g_shm + e->postings, e->bytes);
+        e->postings = off;
+        e->cap = cap;
+    }
+
+    uint8_t *p = (uint8_t*)g_shm + e->postings + e->bytes;
+    uint32_t gap = id - e->last_id;
+    uint32_t n = 0;
+    while (gap >= 0x80) {
+        p[n++] = (uint8_t)(gap | 0x80);
+        gap >>= 7;
+    }
+    p[n++] = (uint8_t)gap;
+    e->bytes += n;
+    e->count++;
+    e->last_id = id;
+    g_shm->search_bytes += n;
+    return 0;
+}
+
+// Indexe le titre et la description du ticket id. Stockage plein : le ticket n'est
+// pas trouvé par search mais reste présent partout ailleurs.
+// Appelant : index_lock verrouillé
+static void search_index_ticket(uint32_t id, const ticket_text_t *x) {
+    char term[SEARCH_TERM_MAX];
+
+    seq_write_begin(&g_shm->search_seq);
+    for (int field = 0; field < 2; field++) {
+        const char *p = field == 0 ? text_title(x) : text_desc(x);
+        while ((p = search_next_term(p, term)) != NULL) {
+            search_term_t *e = search_intern(term);
+            // Terme déjà vu dans ce ticket (ou ID hors d'ordre, qui casserait le codage par écart)
+            if (!e || id <= e->last_id) continue;
+            search_postings_add(e, id);
+        }
+    }
+    seq_write_end(&g_shm->search_seq);
+}
+
+// Vide le dictionnaire avant de le reconstruire : une table neuve, l'ancienne et ses
+// listes restant lisibles par une recherche en cours
+// Appelant : index_lock verrouillé
+static void search_reset(void) {
+    if (g_shm->search_used == 0) return;
+    // Même taille : un lecteur qui a lu l'ancienne taille ne sort pas de la nouvelle table
+    uint64_t off = shm_alloc(sizeof(search_term_t) * g_shm->search_cap);
+    if (off == 0)
+        perror_exit("Erreur lors de la reconstruction de l'index de recherche");
+
+    if (!(g_shm->search_seq & 1)) seq_write_begin(&g_shm->search_seq);
+    g_shm->search_index = off;
+    g_shm->search_used = 0;
+    g_shm->search_bytes = 0;
+    seq_write_end(&g_shm->search_seq);
+}
+
+/* -------------------
+ * Reconstruction des index : après une reprise, ou quand un processus est mort
+ * en tenant un verrou du stockage
+ * ------------------- */
+
+// Vide une liste ; son compteur de séquence avance (et redevient pair si l'écrivain
+// est mort au milieu d'une modification) : un lecteur en cours recommence
+static void list_reset(list_head_t *h) {
+    if (!(h->seq & 1)) seq_write_begin(&h->seq);
+    h->head = h->tail = h->count = 0;
+    seq_write_end(&h->seq);
+}
+
+// Refait les index, les listes, les compteurs, la liste des slots libres et l'index de
+// recherche à partir du contenu des slots (après une reprise, ou si ces structures sont douteuses)
+// Appelant : index_lock verrouillé
+static void store_rebuild_indexes(void) {
+    uint32_t max_id = 0;
+
+    for (uint32_t uid = 0; uid < g_shm->user_count; uid++) {
+        user_entry_t *u = user_at(uid);
+        list_reset(&u->owned);
+        list_reset(&u->assigned);
+        u->in_progress = 0;
+    }
+    for (int k = 0; k < 4; k++) list_reset(&g_shm->state_lists[k]);
+    memset(id_index_table(), 0, sizeof(id_index_entry_t) * g_shm->id_index_cap);
+    g_shm->id_index_used = 0;
+    g_shm->live_tickets = 0;
+
+    // Parcours par slot croissant : les insertions triées par ID se font presque toujours en queue
+    for (uint32_t slot = 0; slot < g_shm->slot_count; slot++) {
+        ticket_hot_t *t = ticket_at(slot);
+        if (t->id == 0) continue;
+        // Ticket à moitié créé par un processus mort (jamais confirmé) : le slot redevient libre
+        if (t->text == 0 || t->owner_uid >= g_shm->user_count) {
+            t->id = 0;
+            continue;
+        }
+
+        memset(&t->owner_link, 0, sizeof(t->owner_link));
+        memset(&t->tech_link, 0, sizeof(t->tech_link));
+        memset(&t->state_link, 0, sizeof(t->state_link));
+        if (id_index_reserve() != 0)
+            perror_exit("Erreur lors de la reconstruction de l'index des tickets");
+        id_index_insert(t->id, slot);
+
+        list_insert_sorted(&user_at(t->owner_uid)->owned, slot, offsetof(ticket_hot_t, owner_link));
+        if (t->tech_uid) {
+            user_entry_t *u = user_at(t->tech_uid - 1);
+            list_insert_sorted(&u->assigned, slot, offsetof(ticket_hot_t, tech_link));
+            if (t->state == IN_PROGRESS) u->in_progress++;
+        }
+        list_insert_sorted(state_list(t->state), slot, offsetof(ticket_hot_t, state_link));
+
+        g_shm->live_tickets++;
+        if (t->id > max_id) max_id = t->id;
+    }
+
+    // Slots libres, le plus petit en tête
+    g_shm->free_head = 0;
+    for (uint32_t slot = g_shm->slot_count; slot-- > 0;) {
+        ticket_hot_t *t = ticket_at(slot);
+        if (t->id != 0) continue;
+        t->next_free = g_shm->free_head;
+        g_shm->free_head = slot + 1;
+    }
+    if (g_shm->next_id <= max_id) g_shm->next_id = max_id + 1;
+
+    // Index de recherche, par ID croissant comme à la création des tickets
+    search_reset();
+    for (uint32_t id = 1; id < g_shm->next_id; id++) {
+        int64_t slot = id_index_find(id);
+        if (slot >= 0)
+            search_index_ticket(id, (const ticket_text_t*)((char*)g_shm + ticket_at((uint32_t)slot)->text));
+    }
+
+    // Charges des techniciens recomptées : le tas de la répartition est refait
+    tech_rebuild();
+}
+
+// Refait la table nom -> utilisateur ; une entrée en cours d'ajout (user_count pas
+// encore avancé) disparaît avec le processus qui l'ajoutait
+// Appelant : index_lock verrouillé
+static void user_dir_repair(void) {
+    if (!(g_shm->dir_seq & 1)) seq_write_begin(&g_shm->dir_seq);
+    uint32_t *tab = user_index_table();
+    memset(tab, 0, sizeof(uint32_t) * g_shm->user_index_cap);
+    for (uint32_t uid = 0; uid < g_shm->user_count; uid++)
+        user_index_put(tab, g_shm->user_index_cap, uid);
+    seq_write_end(&g_shm->dir_seq);
+}
+
+// Remet la structure en état après la mort d'un processus qui la modifiait : tout ce
+// qui se déduit des slots (index, listes, compteurs, slots libres) est refait
+// Appelant : index_lock verrouillé
+static void store_repair(void) {
+    fprintf(stderr, "Verrou repris à un processus mort : reconstruction des index du stockage\n");
+    user_dir_repair();
+    store_rebuild_indexes();
+    __atomic_store_n(&g_shm->repair_needed, 0, __ATOMIC_RELEASE);
+}
+
+static void index_lock(void) {
+    if (stat_lock(&g_shm->index_lock, LOCK_INDEX) || __atomic_load_n(&g_shm->repair_needed, __ATOMIC_ACQUIRE))
+        store_repair();
+}
+
+static void index_unlock(void) {
+    stat_unlock(&g_shm->index_lock, LOCK_INDEX);
+    if (t_change_wake) {
+        t_change_wake = 0;
+        change_notify();
+    }
+}
+
+/* -------------------
+ * Relevés des listes et création des tickets
+ * ------------------- */
+
+// Référence vers un ticket relevée dans une liste
+typedef struct {
+    uint32_t slot;
+    uint32_t id;
+} slot_ref_t;
+
+// Portion d'une liste triée par ID à relever
+typedef struct {
+    uint32_t after;                 // Tickets d'ID > after
+    time_t since;                   // Créés à partir de since (0 = tous)
+    uint32_t max;                   // Au plus max références (0 = toutes)
+    int state;                      // État de la liste, -1 si ce n'est pas une liste d'état
+} list_range_t;
+
+// Suivant du ticket r->after dans la liste de l'état r->state, si ce ticket y est encore
+// Retourne -1 si le raccourci ne s'applique pas
+static int64_t list_range_hint(const list_range_t *r, size_t link_off) {
+    if (r->after == 0 || r->state < 0) return -1;
+    int64_t slot = id_index_find(r->after);
+    if (slot < 0) return -1;
+
+    // L'état et le chaînage dans les listes d'état changent ensemble, sous le seqlock du ticket
+    ticket_hot_t *t = ticket_at((uint32_t)slot);
+    uint32_t s = seq_read_begin(&t->seq);
+    int member = t->id == r->after && (int)t->state == r->state;
+    uint32_t next = ticket_link((uint32_t)slot, link_off)->next;
+    if (seq_read_retry(&t->seq, s) || !member) return -1;
+    return next;
+}
+
+// Relevé des (slot, id) de la portion r d'une liste (NULL = toute la liste), dans l'ordre
+// de la liste. Le début de la portion est pris après le ticket r->after ou, à défaut, en
+// remontant depuis la fin (ID et dates de création décroissants) : les tickets plus
+// anciens que la portion ne sont pas parcourus.
+// Retourne -1 si la liste a changé pendant le parcours (ou est plus longue que prévu)
+static int64_t list_collect_once(const list_head_t *h, size_t link_off, const list_range_t *r,
+                                 slot_ref_t *out, uint32_t cap) {
+    static const list_range_t whole = { 0, 0, 0, -1 };
+    uint32_t budget = 2 * __atomic_load_n(&h->count, __ATOMIC_RELAXED) + 16;
+    uint32_t cur = h->head, n = 0;
+
+    if (!r) r = &whole;
+    if (r->after || r->since) {
+        int64_t next = list_range_hint(r, link_off);
+        if (next >= 0) {
+            cur = (uint32_t)next;
+        } else {
+            cur = 0;
+            for (uint32_t p = h->tail; p != 0; p = ticket_link(p - 1, link_off)->prev) {
+                ticket_hot_t *t = ticket_at(p - 1);
+                if (t->id <= r->after || t->created < r->since) break;
+                if (budget-- == 0) return -1;
+                cur = p;
+            }
+        }
+    }
+    for (; cur != 0 && (r->max == 0 || n < r->max); cur = ticket_link(cur - 1, link_off)->next) {
+        if (budget-- == 0 || n == cap) return -1;
+        ticket_hot_t *t = ticket_at(cur - 1);
+        if (t->id <= r->after || t->created < r->since) continue;
+        out[n].slot = cur - 1;
+        out[n].id = t->id;
+        n++;
+    }
+    return n;
+}
+
+// Relevé d'une liste pour un listing : sans verrou, recommencé si la liste change
+// pendant le parcours ; après SEQ_READ_RETRIES échecs, parcours sous index_lock
+// (en mode verrou global, l'appelant tient déjà index_lock)
+// Retourne le nombre de références (*out à libérer), -1 si la mémoire manque
+static int64_t list_collect(const list_head_t *h, size_t link_off, const list_range_t *r, slot_ref_t **out) {
+    if (g_cfg.global_lock) {
+        uint32_t max = h->count + 1;
+        if (r && r->max && r->max < max) max = r->max;
+        *out = malloc(sizeof(**out) * max);
+        return *out ? list_collect_once(h, link_off, r, *out, max) : -1;
+    }
+    for (int attempt = 0; attempt <= SEQ_READ_RETRIES; attempt++) {
+        int locked = attempt == SEQ_READ_RETRIES;
+        if (locked) index_lock();
+
+        uint32_t s = seq_read_begin(&h->seq);
+        uint32_t max = __atomic_load_n(&h->count, __ATOMIC_RELAXED) + 16;
+        if (r && r->max && r->max < max) max = r->max;
+        slot_ref_t *refs = malloc(sizeof(*refs) * max);
+        if (!refs) {
+            if (locked) index_unlock();
+            return -1;
+        }
+        int64_t n = (s & 1) && !locked ? -1 : list_collect_once(h, link_off, r, refs, max);
+        int stale = !locked && seq_read_retry(&h->seq, s);
+        if (locked) index_unlock();
+
+        if (n >= 0 && !stale) {
+            *out = refs;
+            return n;
+        }
+        free(refs);
+    }
+    return -1;
+}
+
+// Réserve un slot : d'abord un slot libéré, sinon le suivant de la dernière page,
+// sinon une nouvelle page. Retourne -1 si le stockage est plein.
+static int64_t alloc_ticket_slot(void) {
+    if (g_shm->free_head != 0) {
+        uint32_t slot = g_shm->free_head - 1;
+        g_shm->free_head = ticket_at(slot)->next_free;
+        return slot;
+    }
+    if (g_shm->slot_count == g_shm->slab_count * SLAB_TICKETS) {
+        if (g_shm->slab_count == MAX_SLABS) return -1;
+        uint64_t off = shm_alloc(sizeof(ticket_hot_t) * SLAB_TICKETS);
+        if (off == 0) return -1;
+        g_shm->slabs[g_shm->slab_count++] = off;
+    }
+    return g_shm->slot_count++;
+}
+
+// Rend un slot au stockage (ticket supprimé ou archivé) pour qu'il soit réutilisé
+// Appelant : index_lock verrouillé
+static void release_ticket_slot(uint32_t slot) {
+    ticket_hot_t *t = ticket_at(slot);
+
+    list_remove(&user_at(t->owner_uid)->owned, slot, offsetof(ticket_hot_t, owner_link));
+    ticket_write_begin(slot);
+    if (t->tech_uid) {
+        user_entry_t *u = user_at(t->tech_uid - 1);
+        if (t->state == IN_PROGRESS) __atomic_fetch_sub(&u->in_progress, 1, __ATOMIC_RELAXED);
+        list_remove(&u->assigned, slot, offsetof(ticket_hot_t, tech_link));
+        tech_update(t->tech_uid - 1);
+    }
+    list_remove(state_list(t->state), slot, offsetof(ticket_hot_t, state_link));
+    id_index_remove(t->id);
+
+    // Le compteur de séquence survit au slot : un lecteur en retard voit qu'il a changé
+    uint32_t seq = t->seq;
+    memset(t, 0, sizeof(*t));
+    t->seq = seq;
+    ticket_write_end(slot);
+    t->next_free = g_shm->free_head;
+    g_shm->free_head = slot + 1;
+    g_shm->live_tickets--;
+}
+
+// Ajoute un nouveau ticket
+// Paramètres : 
+// uid = l'utilisateur créant le ticket (uid dans l'annuaire)
+// title = le titre du ticket
+// desc = la description du ticket
+// out_id = pointeur vers l'adresse qui sera l'id du ticket créé
+// Retourne -1 si le stockage est plein
+// Appelant : index_lock verrouillé
+static int insert_ticket(uint32_t uid, const char *title, const char *desc, uint32_t *out_id) {
+    
+    // Récupère un slot pour le nouveau ticket (et sa place dans les index)
+    // Le slot d'abord : le texte, jamais libéré, n'est écrit que si le ticket sera créé
+    if (id_index_reserve() != 0) return -1;
+    int64_t slot = alloc_ticket_slot();
+    if (slot < 0) return -1;
+    ticket_hot_t *t = ticket_at((uint32_t)slot);
+    uint64_t text = ticket_text_store(title, desc);
+    if (text == 0) {
+        // Arène pleine : le slot, encore libre (id 0), retourne dans la liste des slots libres
+        t->next_free = g_shm->free_head;
+        g_shm->free_head = (uint32_t)slot + 1;
+        return -1;
+    }
+
+    // On remplit les infos du ticket
+    ticket_write_begin((uint32_t)slot);
+    t->id = g_shm->next_id++;
+    t->next_free = 0;
+    t->text = text;
+    t->state = OPEN;
+    t->owner_uid = uid;
+    t->tech_uid = 0;
+    t->created = time(NULL);
+    wal_log_insert(t->id, t->created, user_at(uid)->name, title, desc);
+    audit_log(AUDIT_CREATE, t->id, user_at(uid)->name, NULL);
+    change_publish(t->id, OPEN, 0);
+    ticket_write_end((uint32_t)slot);
+    g_shm->live_tickets++;
+    id_index_insert(t->id, (uint32_t)slot);
+    search_index_ticket(t->id, (const ticket_text_t*)((char*)g_shm + text));
+    list_append(&user_at(uid)->owned, (uint32_t)slot, offsetof(ticket_hot_t, owner_link));
+
+    // Le ticket rejoint la file d'escalade ; si elle était vide, l'échéance la plus proche change
+    int wake = state_list(OPEN)->head == 0;
+    list_append(state_list(OPEN), (uint32_t)slot, offsetof(ticket_hot_t, state_link));
+    if (wake) {
+        pthread_mutex_lock(&g_escalator_lock);
+        pthread_cond_signal(&g_escalator_cond);
+        pthread_mutex_unlock(&g_escalator_lock);
+    }
+
+    // Id du ticket créé
+    *out_id = t->id;
+
+    return 0;
+}
+
+// Fusionne deux relevés triés par ID dans dst (taille na + nb)
+static int64_t refs_merge(const slot_ref_t *a, int64_t na, const slot_ref_t *b, int64_t nb, slot_ref_t *dst) {
+    int64_t i = 0, j = 0, n = 0;
+
+    while (i < na || j < nb) {
+        if (j >= nb || (i < na && a[i].id < b[j].id)) dst[n++] = a[i++];
+        else dst[n++] = b[j++];
+    }
+    return n;
+}
+
+// Position de la première référence d'ID > after dans un relevé trié
+static int64_t refs_seek(const slot_ref_t *refs, int64_t n, uint32_t after) {
+    int64_t lo = 0, hi = n;
+
+    while (lo < hi) {
+        int64_t mid = (lo + hi) / 2;
+        if (refs[mid].id <= after) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* -------------------
+ * Archives : les tickets CLOSED anciens quittent le stockage pour des segments immuables
+ * sur disque, lus par mmap. Le compacteur (premier processus) écrit un segment, le publie
+ * dans la table de la mémoire partagée, puis rend les slots de ses tickets et journalise
+ * l'archivage (WAL_ARCHIVE) : une reprise retire à nouveau ces tickets du stockage.
+ * Segment : fichier <archive_path>.<numéro>, en-tête puis tickets par ID croissant, index
+ * clairsemé (un ticket sur ARCHIVE_INDEX_STEP), tickets de chaque propriétaire par ID
+ * croissant et table des propriétaires triée par nom.
+ * ------------------- */
+
+// En-tête d'un segment
+typedef struct {
+    char magic[8];                  // ARCHIVE_MAGIC
+    uint32_t count;                 // Tickets
+    uint32_t first_id;
+    uint32_t last_id;
+    uint32_t index_count;           // Entrées de l'index clairsemé
+    uint32_t owner_count;           // Propriétaires distincts
+    uint32_t pad;
+    uint64_t index_off;             // Index clairsemé (archive_index_t), fin des tickets
+    uint64_t refs_off;              // Tickets de chaque propriétaire (archive_index_t)
+    uint64_t owner_off;             // Table des propriétaires (archive_owner_t)
+    uint64_t size;                  // Taille du fichier
+} archive_header_t;
+
+// Ticket archivé ; les chaînes suivent l'enregistrement, sans '\0'
+typedef struct {
+    uint32_t id;
+    uint32_t size;                  // Taille de l'enregistrement (multiple de 8)
+    int64_t created;
+    uint8_t state;
+    uint8_t owner_len;
+    uint8_t tech_len;
+    uint8_t pad;
+    uint16_t title_len;
+    uint16_t desc_len;
+    char data[];                    // Propriétaire, technicien, titre, description
+} archive_record_t;
+
+// Position d'un ticket dans le segment
+typedef struct {
+    uint32_t id;
+    uint32_t pad;
+    uint64_t off;
+} archive_index_t;
+
+// Propriétaire et ses tickets dans le segment (refs_off + start, count entrées)
+typedef struct {
+    char name[MAX_USER];
+    uint32_t start;
+    uint32_t count;
+} archive_owner_t;
+
+// Segments mappés par ce processus (même numérotation que la table partagée)
+static const archive_header_t *g_archive_maps[ARCHIVE_MAX_SEGMENTS];
+static pthread_mutex_t g_archive_map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static archive_segment_t *archive_table(void) {
+    return (archive_segment_t*)((char*)g_shm + g_shm->archive_segments);
+}
+
+static void archive_segment_path(uint32_t seq, char *path, size_t len) {
+    snprintf(path, len, "%s.%08x", g_cfg.archive_path, seq);
+}
+
+// Enregistrement à l'offset off, NULL s'il déborde de la zone des tickets
+static const archive_record_t *archive_record(const archive_header_t *h, uint64_t off) {
+    if (off < sizeof(*h) || off > h->index_off || h->index_off - off < sizeof(archive_record_t)) return NULL;
+    const archive_record_t *r = (const archive_record_t*)((const char*)h + off);
+    if (r->size < sizeof(*r) || r->size > h->index_off - off ||
+        (uint64_t)r->owner_len + r->tech_len + r->title_len + r->desc_len > r->size - sizeof(*r) ||
+        r->owner_len >= MAX_USER || r->tech_len >= MAX_USER || r->title_len >= MAX_TITLE || r->desc_len >= MAX_DESC)
+        return NULL;
+    return r;
+}
+
+// Mappe le segment seq et vérifie sa structure
+// Retourne NULL si le fichier est absent ou invalide
+static const archive_header_t *archive_open(uint32_t seq) {
+    char path[4096];
+    struct stat st;
+
+    archive_segment_path(seq, path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(archive_header_t)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    const archive_header_t *h = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED) return NULL;
+
+    if (memcmp(h->magic, ARCHIVE_MAGIC, 8) != 0 || h->size != size || h->count == 0 ||
+        h->index_count != (h->count + ARCHIVE_INDEX_STEP - 1) / ARCHIVE_INDEX_STEP ||
+        h->index_off > size || (size - h->index_off) / sizeof(archive_index_t) < h->index_count ||
+        h->refs_off > size || (size - h->refs_off) / sizeof(archive_index_t) < h->count ||
+        h->owner_off > size || (size - h->owner_off) / sizeof(archive_owner_t) < h->owner_count) {
+        munmap((void*)h, size);
+        return NULL;
+    }
+    return h;
+}
+
+// Segment n° i de la table, mappé à sa première lecture par ce processus
+static const archive_header_t *archive_map(uint32_t i) {
+    const archive_header_t *h = __atomic_load_n(&g_archive_maps[i], __ATOMIC_ACQUIRE);
+    if (h) return h;
+
+    pthread_mutex_lock(&g_archive_map_lock);
+    h = g_archive_maps[i];
+    if (!h) {
+        h = archive_open(archive_table()[i].seq);
+        if (h) __atomic_store_n(&g_archive_maps[i], h, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_archive_map_lock);
+    return h;
+}
+
+// Ticket id dans le segment : dernière entrée de l'index clairsemé d'ID <= id, puis au
+// plus ARCHIVE_INDEX_STEP tickets parcourus
+static const archive_record_t *archive_find_in(const archive_header_t *h, uint32_t id) {
+    const archive_index_t *idx = (const archive_index_t*)((const char*)h + h->index_off);
+    uint32_t lo = 0, hi = h->index_count;
+
+    if (id < h->first_id || id > h->last_id) return NULL;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (idx[mid].id <= id) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return NULL;
+    uint64_t off = idx[lo - 1].off;
+    for (int k = 0; k < ARCHIVE_INDEX_STEP; k++) {
+        const archive_record_t *r = archive_record(h, off);
+        if (!r || r->id > id) return NULL;
+        if (r->id == id) return r;
+        off += r->size;
+    }
+    return NULL;
+}
+
+// Ticket id dans les archives (les plages d'ID des segments peuvent se chevaucher)
+// Retourne l'enregistrement et le numéro de son segment dans *seg, NULL s'il n'est pas archivé
+static const archive_record_t *archive_locate(uint32_t id, uint32_t *seg) {
+    uint32_t n = __atomic_load_n(&g_shm->archive_count, __ATOMIC_ACQUIRE);
+    const archive_segment_t *tab = archive_table();
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (id < tab[i].first_id || id > tab[i].last_id) continue;
+        const archive_header_t *h = archive_map(i);
+        const archive_record_t *r = h ? archive_find_in(h, id) : NULL;
+        if (r) {
+            if (seg) *seg = i;
+            return r;
+        }
+    }
+    return NULL;
+}
+
+// Copie un ticket archivé ; les noms sont rattachés à l'annuaire quand il les connaît
+static void archive_copy(const archive_record_t *r, ticket_t *out) {
+    const char *p = r->data;
+
+    memset(out, 0, sizeof(*out));
+    out->id = r->id;
+    out->state = (ticket_state_t)r->state;
+    out->created = (time_t)r->created;
+    memcpy(out->owner, p, r->owner_len); p += r->owner_len;
+    memcpy(out->technician, p, r->tech_len); p += r->tech_len;
+    memcpy(out->title, p, r->title_len); p += r->title_len;
+    memcpy(out->desc, p, r->desc_len);
+    int64_t uid = user_find(out->owner);
+    out->owner_uid = uid >= 0 ? (uint32_t)uid : UINT32_MAX;
+    uid = out->technician[0] ? user_find(out->technician) : -1;
+    out->tech_uid = uid >= 0 ? (uint32_t)uid + 1 : 0;
+}
+
+// Copie du ticket d'une référence relevée : dans le stockage, ou dans le segment d'archive
+// (ARCHIVE_REF | numéro). Un ticket archivé depuis le relevé est relu dans les archives ;
+// out->id vaut 0 si le ticket n'existe plus.
+static void ticket_read_ref(const slot_ref_t *ref, ticket_t *out) {
+    const archive_record_t *r = NULL;
+
+    if (!(ref->slot & ARCHIVE_REF)) {
+        ticket_read(ref->slot, out);
+        if (out->id == ref->id) return;
+        r = archive_locate(ref->id, NULL);
+    } else {
+        const archive_header_t *h = archive_map(ref->slot & ~ARCHIVE_REF);
+        r = h ? archive_find_in(h, ref->id) : NULL;
+    }
+    if (r) archive_copy(r, out);
+    else out->id = 0;
+}
+
+static int slot_ref_cmp(const void *a, const void *b) {
+    uint32_t x = ((const slot_ref_t*)a)->id, y = ((const slot_ref_t*)b)->id;
+    return x < y ? -1 : x > y;
+}
+
+// Relevé des tickets archivés du propriétaire name, par ID croissant
+// Retourne leur nombre (*out à libérer), -1 si la mémoire manque
+static int64_t archive_collect_owner(const char *name, slot_ref_t **out) {
+    uint32_t n = __atomic_load_n(&g_shm->archive_count, __ATOMIC_ACQUIRE);
+    slot_ref_t *refs = NULL;
+    int64_t count = 0, cap = 0;
+    int sources = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        const archive_header_t *h = archive_map(i);
+        if (!h) continue;
+        // Propriétaire cherché par dichotomie dans la table triée par nom
+        const archive_owner_t *owners = (const archive_owner_t*)((const char*)h + h->owner_off);
+        uint32_t lo = 0, hi = h->owner_count;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (strncmp(owners[mid].name, name, MAX_USER) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == h->owner_count || strncmp(owners[lo].name, name, MAX_USER) != 0) continue;
+        const archive_owner_t *o = &owners[lo];
+        if (o->start > h->count || o->count > h->count - o->start) continue;
+
+        if (count + o->count > cap) {
+            cap = (count + o->count) * 2;
+            slot_ref_t *p = realloc(refs, sizeof(*p) * (size_t)cap);
+            if (!p) {
+                free(refs);
+                return -1;
+            }
+            refs = p;
+        }
+        const archive_index_t *r = (const archive_index_t*)((const char*)h + h->refs_off) + o->start;
+        for (uint32_t k = 0; k < o->count; k++) {
+            refs[count].slot = ARCHIVE_REF | i;
+            refs[count++].id = r[k].id;
+        }
+        sources++;
+    }
+    // Chaque segment est trié, mais leurs plages d'ID se chevauchent
+    if (sources > 1) qsort(refs, (size_t)count, sizeof(*refs), slot_ref_cmp);
+    *out = refs;
+    return count;
+}
+
+// Rend les slots des tickets du segment n° i (publié) encore présents dans le stockage,
+// par lots sous index_lock, puis journalise l'archivage
+static void archive_release(uint32_t i) {
+    const archive_header_t *h = archive_map(i);
+    if (!h) return;
+
+    uint64_t off = sizeof(*h);
+    uint32_t k = 0;
+    while (k < h->count) {
+        index_lock();
+        for (uint32_t end = k + ARCHIVE_RELEASE_BATCH; k < h->count && k < end; k++) {
+            const archive_record_t *r = archive_record(h, off);
+            if (!r) {
+                k = h->count;
+                break;
+            }
+            off += r->size;
+            int64_t slot = id_index_find(r->id);
+            if (slot >= 0 && ticket_at((uint32_t)slot)->state == CLOSED) release_ticket_slot((uint32_t)slot);
+        }
+        index_unlock();
+    }
+    index_lock();
+    wal_log_archive(archive_table()[i].seq, h->count);
+    index_unlock();
+    wal_sync(t_wal_lsn);
+}
+
+// Rejeu d'un archivage : les tickets du segment seq quittent le stockage (les listes et
+// compteurs seront refaits par store_rebuild_indexes)
+// Appelant : index_lock verrouillé (reprise)
+static void archive_replay(uint32_t seq) {
+    uint32_t n = g_shm->archive_count;
+    uint32_t i = 0;
+
+    while (i < n && archive_table()[i].seq != seq) i++;
+    const archive_header_t *h = i < n ? archive_map(i) : NULL;
+    if (!h) {
+        fprintf(stderr, "Segment d'archive %08x absent : ses tickets restent dans le stockage\n", seq);
+        return;
+    }
+    uint64_t off = sizeof(*h);
+    for (uint32_t k = 0; k < h->count; k++) {
+        const archive_record_t *r = archive_record(h, off);
+        if (!r) break;
+        off += r->size;
+        int64_t slot = id_index_find(r->id);
+        if (slot < 0) continue;
+        ticket_at((uint32_t)slot)->id = 0;
+        id_index_remove(r->id);
+        g_shm->live_tickets--;
+    }
+}
+
+// Refait la table des segments depuis le disque (premier processus, avant la reprise)
+static void archive_load(void) {
+    uint64_t *seqs;
+    int n = list_numbered_files(g_cfg.archive_path, 8, &seqs);
+
+    index_lock();
+    g_shm->archive_count = g_shm->archive_next = 0;
+    g_shm->archive_tickets = g_shm->archive_bytes = 0;
+    for (int k = 0; k < n; k++) {
+        uint32_t i = g_shm->archive_count;
+        if (i == ARCHIVE_MAX_SEGMENTS) {
+            fprintf(stderr, "Trop de segments d'archive : les suivants sont ignorés\n");
+            break;
+        }
+        const archive_header_t *h = archive_open((uint32_t)seqs[k]);
+        if (!h) {
+            fprintf(stderr, "Segment d'archive %08x illisible : ignoré\n", (uint32_t)seqs[k]);
+            continue;
+        }
+        archive_segment_t *e = &archive_table()[i];
+        e->seq = (uint32_t)seqs[k];
+        e->count = h->count;
+        e->first_id = h->first_id;
+        e->last_id = h->last_id;
+        e->size = h->size;
+        g_archive_maps[i] = h;
+        g_shm->archive_tickets += h->count;
+        g_shm->archive_bytes += h->size;
+        g_shm->archive_next = e->seq + 1;
+        if (h->last_id >= g_shm->next_id) g_shm->next_id = h->last_id + 1;
+        g_shm->archive_count = i + 1;
+    }
+    index_unlock();
+    free(seqs);
+}
+
+// Ticket mis en forme dans un segment (ordre de ticket_t)
+typedef struct {
+    uint32_t owner_uid;
+    uint32_t id;
+    uint64_t off;
+} archive_entry_t;
+
+// Par nom de propriétaire puis par ID
+static int archive_entry_cmp(const void *a, const void *b) {
+    const archive_entry_t *x = a, *y = b;
+    int c = x->owner_uid == y->owner_uid ? 0 :
+            strncmp(user_at(x->owner_uid)->name, user_at(y->owner_uid)->name, MAX_USER);
+    if (c != 0) return c;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+// Met en forme un ticket ; retourne la taille de l'enregistrement
+static size_t archive_encode(const ticket_t *t, uint64_t *buf) {
+    archive_record_t *r = (archive_record_t*)buf;
+    char *p = r->data;
+
+    r->id = t->id;
+    r->created = (int64_t)t->created;
+    r->state = (uint8_t)t->state;
+    r->owner_len = (uint8_t)strnlen(t->owner, MAX_USER - 1);
+    r->tech_len = (uint8_t)strnlen(t->technician, MAX_USER - 1);
+    r->pad = 0;
+    r->title_len = (uint16_t)strnlen(t->title, MAX_TITLE - 1);
+    r->desc_len = (uint16_t)strnlen(t->desc, MAX_DESC - 1);
+    memcpy(p, t->owner, r->owner_len); p += r->owner_len;
+    memcpy(p, t->technician, r->tech_len); p += r->tech_len;
+    memcpy(p, t->title, r->title_len); p += r->title_len;
+    memcpy(p, t->desc, r->desc_len); p += r->desc_len;
+    size_t len = (size_t)(p - (char*)buf);
+    size_t size = (len + 7) & ~(size_t)7;
+    memset(p, 0, size - len);
+    r->size = (uint32_t)size;
+    return size;
+}
+
+// Écrit dans le fichier seq les tickets relevés (encore CLOSED), puis le rend durable
+// Retourne le nombre de tickets écrits (0 : aucun, fichier non créé), -1 en cas d'erreur
+static int64_t archive_write(uint32_t seq, const slot_ref_t *refs, int64_t n, archive_header_t *h) {
+    char path[4096], tmp[4200];
+    uint64_t buf[(sizeof(archive_record_t) + 2 * MAX_USER + MAX_TITLE + MAX_DESC) / 8 + 1];
+    uint32_t steps = (uint32_t)((n + ARCHIVE_INDEX_STEP - 1) / ARCHIVE_INDEX_STEP);
+    archive_entry_t *ents = malloc(sizeof(*ents) * (size_t)n);
+    archive_index_t *sparse = malloc(sizeof(*sparse) * steps);
+
+    archive_segment_path(seq, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = ents && sparse ? fopen(tmp, "wb") : NULL;
+    if (!fp) {
+        free(ents);
+        free(sparse);
+        return -1;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+    memset(h, 0, sizeof(*h));
+    fwrite(h, sizeof(*h), 1, fp);
+    uint64_t off = sizeof(*h);
+    uint32_t count = 0;
+    for (int64_t i = 0; i < n; i++) {
+        ticket_t t;
+        // En mode verrou global, ticket_read suppose index_lock tenu
+        if (g_cfg.global_lock) index_lock();
+        ticket_read(refs[i].slot, &t);
+        if (g_cfg.global_lock) index_unlock();
+        if (t.id != refs[i].id || t.state != CLOSED) continue;
+
+        size_t len = archive_encode(&t, buf);
+        if (count % ARCHIVE_INDEX_STEP == 0) {
+            sparse[count / ARCHIVE_INDEX_STEP].id = t.id;
+            sparse[count / ARCHIVE_INDEX_STEP].pad = 0;
+            sparse[count / ARCHIVE_INDEX_STEP].off = off;
+        }
+        ents[count].owner_uid = t.owner_uid;
+        ents[count].id = t.id;
+        ents[count].off = off;
+        if (count == 0) h->first_id = t.id;
+        h->last_id = t.id;
+        fwrite(buf, 1, len, fp);
+        off += len;
+        count++;
+    }
+    if (count == 0) {
+        fclose(fp);
+        unlink(tmp);
+        free(ents);
+        free(sparse);
+        return 0;
+    }
+
+    // Index clairsemé, puis tickets regroupés par propriétaire et table des propriétaires
+    h->count = count;
+    h->index_count = (count + ARCHIVE_INDEX_STEP - 1) / ARCHIVE_INDEX_STEP;
+    h->index_off = off;
+    fwrite(sparse, sizeof(*sparse), h->index_count, fp);
+    off += sizeof(*sparse) * h->index_count;
+
+    qsort(ents, count, sizeof(*ents), archive_entry_cmp);
+    h->refs_off = off;
+    for (uint32_t k = 0; k < count; k++) {
+        archive_index_t e = { ents[k].id, 0, ents[k].off };
+        fwrite(&e, sizeof(e), 1, fp);
+    }
+    off += sizeof(archive_index_t) * count;
+    h->owner_off = off;
+    for (uint32_t k = 0; k < count;) {
+        archive_owner_t o;
+        memset(&o, 0, sizeof(o));
+        memcpy(o.name, user_at(ents[k].owner_uid)->name, MAX_USER);
+        o.start = k;
+        while (k < count && ents[k].owner_uid == ents[o.start].owner_uid) k++;
+        o.count = k - o.start;
+        fwrite(&o, sizeof(o), 1, fp);
+        off += sizeof(o);
+        h->owner_count++;
+    }
+    h->size = off;
+    memcpy(h->magic, ARCHIVE_MAGIC, 8);
+    free(ents);
+    free(sparse);
+
+    int rc = ferror(fp) || fseek(fp, 0, SEEK_SET) != 0 || fwrite(h, sizeof(*h), 1, fp) != 1 ? -1 : 0;
+    if (fflush(fp) != 0 || fdatasync(fileno(fp)) == -1) rc = -1;
+    if (fclose(fp) != 0) rc = -1;
+    if (rc != 0 || rename(tmp, path) == -1) {
+        unlink(tmp);
+        return -1;
+    }
+    fsync_parent_dir(path);
+    return count;
+}
+
+// Archive un segment de tickets CLOSED créés depuis plus de archive_after secondes, par ID
+// croissant ; moins de ARCHIVE_MIN_TICKETS tickets attendent d'en rejoindre d'autres, sauf
+// si le plus ancien a deux fois l'âge requis
+// Retourne le nombre de tickets archivés, -1 en cas d'erreur
+// Appelant : archive_lock verrouillé
+static int64_t archive_segment(void) {
+    struct timespec t0, t1;
+    time_t now = time(NULL), cutoff = now - g_cfg.archive_after, oldest = now;
+    slot_ref_t *refs;
+
+    if (g_shm->archive_count == ARCHIVE_MAX_SEGMENTS) return 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    // Clôtures sur disque avant leur archivage : une reprise ne retrouve pas un ticket archivé encore ouvert
+    wal_sync(__atomic_load_n(&g_shm->wal_append, __ATOMIC_ACQUIRE));
+
+    int64_t n = list_collect(state_list(CLOSED), offsetof(ticket_hot_t, state_link), NULL, &refs);
+    if (n < 0) return -1;
+    int64_t m = 0;
+    for (int64_t i = 0; i < n && m < ARCHIVE_SEGMENT_TICKETS; i++) {
+        time_t created = __atomic_load_n(&ticket_at(refs[i].slot)->created, __ATOMIC_RELAXED);
+        if (created > cutoff) continue;
+        if (created < oldest) oldest = created;
+        refs[m++] = refs[i];
+    }
+    if (m == 0 || (m < ARCHIVE_MIN_TICKETS && oldest > cutoff - g_cfg.archive_after)) {
+        free(refs);
+        return 0;
+    }
+
+    archive_header_t hdr;
+    uint32_t seq = g_shm->archive_next;
+    int64_t count = archive_write(seq, refs, m, &hdr);
+    free(refs);
+    if (count <= 0) {
+        if (count < 0) perror("Erreur lors de l'écriture d'un segment d'archive");
+        return count;
+    }
+
+    // Publication : le segment est lisible avant que ses tickets quittent le stockage
+    uint32_t i = g_shm->archive_count;
+    const archive_header_t *h = archive_open(seq);
+    if (!h) {
+        fprintf(stderr, "Segment d'archive %08x illisible après écriture\n", seq);
+        return -1;
+    }
+    __atomic_store_n(&g_archive_maps[i], h, __ATOMIC_RELEASE);
+    index_lock();
+    archive_segment_t *e = &archive_table()[i];
+    e->seq = seq;
+    e->count = h->count;
+    e->first_id = h->first_id;
+    e->last_id = h->last_id;
+    e->size = h->size;
+    g_shm->archive_next = seq + 1;
+    g_shm->archive_tickets += h->count;
+    g_shm->archive_bytes += h->size;
+    __atomic_store_n(&g_shm->archive_count, i + 1, __ATOMIC_RELEASE);
+    index_unlock();
+    archive_release(i);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("Archive : %u tickets (ID %u à %u) dans le segment %08x, %.1f Kio (%.1f ms)\n",
+        h->count, h->first_id, h->last_id, seq, h->size / 1024.0,
+        (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    return count;
+}
+
+// Passage du compacteur : segments écrits tant qu'il reste assez de tickets à archiver
+// Retourne le nombre de tickets archivés, -1 en cas d'erreur
+static int64_t archive_run(void) {
+    int rc = pthread_mutex_trylock(&g_shm->archive_lock);
+    if (rc == EBUSY) return 0;
+    // Compacteur mort après avoir publié son segment : ses tickets sont peut-être encore dans le stockage
+    if (shm_mutex_taken(&g_shm->archive_lock, rc) && g_shm->archive_count > 0)
+        archive_release(g_shm->archive_count - 1);
+
+    int64_t total = 0, n;
+    while ((n = archive_segment()) > 0) total += n;
+    pthread_mutex_unlock(&g_shm->archive_lock);
+    return n < 0 ? -1 : total;
+}
+
+// Thread du compacteur (premier processus, avec --archive-after)
+static void *archive_thread(void *arg) {
+    (void)arg;
+    stats_attach();
+
+    while (1) {
+        sleep(g_cfg.archive_after < ARCHIVE_INTERVAL ? (unsigned)g_cfg.archive_after : ARCHIVE_INTERVAL);
+        archive_run();
+    }
+    return NULL;
+}
+
+/* -------------------
+ * Cache des tickets mis en forme : chaque thread garde le texte des derniers tickets
+ * listés (état, noms, date comprise), tant que le compteur de séquence du ticket n'a pas
+ * bougé ; la prise en charge, la clôture et l'escalade le font avancer, et un slot
+ * réutilisé porte un autre ID. Un client reste sur le même worker epoll : ses listings
+ * successifs y retrouvent leurs tickets sans localtime_r ni snprintf.
+ * ------------------- */
+
+#define LIST_OWNER_TAG "owner:"     // Absent de la vue propriétaire
+
+// Ticket mis en forme, dans la vue technicien "ID:n | ÉTAT | owner:x | tech:y | ..."
+typedef struct {
+    uint32_t id;                    // ID du ticket (0 = case vide)
+    uint32_t slot;
+    uint32_t seq;                   // Compteur de séquence du ticket lors de la mise en forme
+    ticket_state_t state;           // Champs de cette version, filtrés par les listings
+    uint32_t owner_uid;
+    uint32_t tech_uid;
+    uint16_t len;                   // Longueur du texte
+    uint16_t owner_at;              // Position de LIST_OWNER_TAG dans le texte
+    uint16_t cap;                   // Taille allouée de text
+    char *text;
+} list_line_t;
+
+static __thread list_line_t *t_list_cache = NULL; // LIST_CACHE_ENTRIES cases, par slot
+
+// Libère le cache du thread (fin d'un thread client ou de banc d'essai)
+static void list_cache_free(void) {
+    if (!t_list_cache) return;
+    for (uint32_t i = 0; i < LIST_CACHE_ENTRIES; i++) free(t_list_cache[i].text);
+    free(t_list_cache);
+    t_list_cache = NULL;
+}
+
+// Met le ticket en forme dans buf (au moins LIST_ENTRY_MAX octets), vue technicien
+static void list_line_format(const ticket_t *t, char *buf, list_line_t *l) {
+    static const char *names[] = { "OPEN", "IN_PROGRESS", "CLOSED", "PRIORITY" };
+    char timebuf[64];
+    struct tm tm;
+
+    localtime_r(&t->created, &tm);
+    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", &tm);
+    int at = snprintf(buf, LIST_ENTRY_MAX, "ID:%u | %s | ", t->id, names[t->state]);
+    int n = snprintf(buf + at, LIST_ENTRY_MAX - (size_t)at,
+        LIST_OWNER_TAG "%s | tech:%s | created:%s\nTitle: %s\nDesc: %s\n\n",
+        t->owner, (t->technician[0] ? t->technician : "-"), timebuf, t->title, t->desc);
+    l->id = t->id;
+    l->state = t->state;
+    l->owner_uid = t->owner_uid;
+    l->tech_uid = t->tech_uid;
+    l->owner_at = (uint16_t)at;
+    l->len = (uint16_t)(at + n < LIST_ENTRY_MAX ? at + n : LIST_ENTRY_MAX - 1);
+}
+
+// Recopie le texte dans la vue demandée ; retourne sa longueur
+static size_t list_line_copy(const list_line_t *l, const char *text, int technician, char *buf) {
+    size_t tag = sizeof(LIST_OWNER_TAG) - 1;
+
+    if (technician) {
+        memcpy(buf, text, l->len);
+        buf[l->len] = '\0';
+        return l->len;
+    }
+    memmove(buf, text, l->owner_at);
+    memmove(buf + l->owner_at, text + l->owner_at + tag, l->len - l->owner_at - tag);
+    buf[l->len - tag] = '\0';
+    return l->len - tag;
+}
+
+// Met en forme le ticket d'une référence relevée dans buf (au moins LIST_ENTRY_MAX octets),
+// depuis le cache du thread si le ticket n'a pas changé ; *meta reçoit l'ID (0 = ticket
+// disparu), l'état, le propriétaire et le technicien de la version écrite
+// Retourne le nombre d'octets écrits
+static size_t list_line_get(const slot_ref_t *ref, int technician, char *buf, list_line_t *meta) {
+    list_line_t *e = NULL;
+    uint32_t s = 1;
+    ticket_t t;
+
+    // Les tickets archivés, immuables, sont lus dans leur segment projeté en mémoire
+    if (g_cfg.list_cache && !(ref->slot & ARCHIVE_REF)) {
+        if (!t_list_cache) t_list_cache = calloc(LIST_CACHE_ENTRIES, sizeof(*t_list_cache));
+        if (t_list_cache) {
+            ticket_hot_t *h = ticket_at(ref->slot);
+            e = &t_list_cache[ref->slot & (LIST_CACHE_ENTRIES - 1)];
+            s = seq_read_begin(&h->seq);
+            uint32_t id = __atomic_load_n(&h->id, __ATOMIC_RELAXED);
+            if (!seq_read_retry(&h->seq, s) && id == ref->id && e->id == id && e->slot == ref->slot && e->seq == s) {
+                *meta = *e;
+                meta->text = NULL;
+                if (t_stats) stat_add(&t_stats->list_cache_hits, 1);
+                return list_line_copy(e, e->text, technician, buf);
+            }
+        }
+    }
+
+    ticket_read_ref(ref, &t);
+    if (t.id == 0) {
+        memset(meta, 0, sizeof(*meta));
+        return 0;
+    }
+    list_line_format(&t, buf, meta);
+    meta->text = NULL;
+    // Version gardée si le compteur n'a pas bougé pendant la lecture (copie de la version s)
+    if (e) {
+        if (t_stats) stat_add(&t_stats->list_cache_misses, 1);
+        if (t.id == ref->id && !seq_read_retry(&ticket_at(ref->slot)->seq, s)) {
+            if (e->cap < meta->len) {
+                char *text = realloc(e->text, meta->len);
+                if (text) {
+                    e->text = text;
+                    e->cap = meta->len;
+                }
+            }
+            if (e->cap >= meta->len) {
+                memcpy(e->text, buf, meta->len);
+                char *text = e->text;
+                uint16_t cap = e->cap;
+                *e = *meta;
+                e->slot = ref->slot;
+                e->seq = s;
+                e->text = text;
+                e->cap = cap;
+            }
+        }
+    }
+    return list_line_copy(meta, buf, technician, buf);
+}
+
+/* -------------------
+ * Listings paginés : le relevé des tickets est pris au début de la commande,
+ * la mise en forme se fait par morceaux, à mesure que le client lit la réponse
+ * ------------------- */
+
+// Curseur d'un listing en cours
+typedef struct {
+    slot_ref_t *refs;               // Relevé trié par ID croissant
+    int64_t count;                  // Références dans refs
+    int64_t pos;                    // Prochaine référence à afficher
+    uint32_t limit;                 // Nombre maximum de tickets affichés (0 = tous)
+    uint32_t shown;                 // Tickets déjà affichés
+    uint32_t last_id;               // Dernier ID examiné (reprise avec --after)
+    int truncated;                  // Relevé coupé : d'autres tickets suivent les références
+    int technician;                 // Vue technicien (sinon vue propriétaire)
+    int all;                        // Tous les tickets, sans le filtre de la vue (recherche, listing par état)
+    int search;                     // Résultats d'une recherche
+    uint32_t states;                // États affichés (bits 1 << état, 0 = tous)
+    int finished;                   // Dernier morceau produit
+    uint32_t uid;                   // Propriétaire ou technicien concerné
+    char name[MAX_USER];            // Son nom (messages)
+    const char *verb;               // Commande à rappeler pour la page suivante
+    char *resume;                   // Ses autres arguments, après --after et --limit (NULL = aucun)
+} list_cursor_t;
+
+// Ouvre le listing des tickets d'un propriétaire, d'ID > after
+// Retourne -1 si la mémoire manque
+static int list_cursor_open_owner(list_cursor_t *c, uint32_t uid, uint32_t after, uint32_t limit) {
+    memset(c, 0, sizeof(*c));
+    c->uid = uid;
+    memcpy(c->name, user_at(uid)->name, MAX_USER);
+    c->limit = limit;
+    c->verb = "sendTicket -l";
+
+    if (g_cfg.global_lock) index_lock();
+    // On parcourt uniquement les tickets de l'utilisateur (liste dans l'ordre de création)
+    c->count = list_collect(&user_at(uid)->owned, offsetof(ticket_hot_t, owner_link), NULL, &c->refs);
+    if (g_cfg.global_lock) index_unlock();
+    if (c->count < 0) return -1;
+
+    // Puis ses tickets archivés, relevés après : un ticket archivé entre-temps figure dans
+    // les deux relevés (affiché une seule fois), il ne peut manquer aux deux
+    slot_ref_t *arch;
+    int64_t na = archive_collect_owner(c->name, &arch);
+    if (na < 0) return -1;
+    if (na > 0) {
+        slot_ref_t *all = malloc(sizeof(*all) * (size_t)(c->count + na));
+        if (!all) {
+            free(arch);
+            return -1;
+        }
+        int64_t n = refs_merge(arch, na, c->refs, c->count, all), m = 0;
+        for (int64_t i = 0; i < n; i++)
+            if (m == 0 || all[i].id != all[m - 1].id) all[m++] = all[i];
+        free(c->refs);
+        c->refs = all;
+        c->count = m;
+    }
+    free(arch);
+    c->pos = refs_seek(c->refs, c->count, after);
+    return 0;
+}
+
+// Liste à relever pour un listing
+typedef struct {
+    list_head_t *head;
+    size_t link_off;
+    int state;                      // État de la liste, -1 si ce n'est pas une liste d'état
+} list_source_t;
+
+// Relève la portion r de chaque liste et fusionne les relevés par ID dans le curseur ;
+// une liste coupée à r.max borne la fusion à son dernier ID relevé, pour que la reprise
+// avec --after ne saute aucun ticket
+// Retourne -1 si la mémoire manque
+static int list_cursor_collect(list_cursor_t *c, const list_source_t *src, int n, list_range_t r) {
+    slot_ref_t *lists[4] = { NULL, NULL, NULL, NULL };
+    int64_t counts[4] = { 0, 0, 0, 0 };
+    int64_t total = 0;
+    uint32_t cut = UINT32_MAX;
+    int rc = 0;
+
+    if (g_cfg.global_lock) index_lock();
+    for (int k = 0; k < n; k++) {
+        r.state = src[k].state;
+        counts[k] = list_collect(src[k].head, src[k].link_off, &r, &lists[k]);
+        if (counts[k] < 0) {
+            rc = -1;
+            counts[k] = 0;
+            continue;
+        }
+        total += counts[k];
+        if (r.max && counts[k] == r.max && lists[k][counts[k] - 1].id < cut)
+            cut = lists[k][counts[k] - 1].id;
+    }
+    if (g_cfg.global_lock) index_unlock();
+
+    slot_ref_t *tmp = rc == 0 ? malloc(sizeof(*tmp) * (total + 1)) : NULL;
+    c->refs = rc == 0 ? malloc(sizeof(*c->refs) * (total + 1)) : NULL;
+    if (tmp && c->refs) {
+        for (int k = 0; k < n; k++) {
+            int64_t m = refs_merge(c->refs, c->count, lists[k], counts[k], tmp);
+            slot_ref_t *swap = c->refs;
+            c->refs = tmp;
+            tmp = swap;
+            c->count = m;
+        }
+        if (cut != UINT32_MAX) {
+            c->count = refs_seek(c->refs, c->count, cut);
+            c->truncated = 1;
+        }
+    } else {
+        rc = -1;
+    }
+    free(tmp);
+    for (int k = 0; k < n; k++) free(lists[k]);
+    return rc;
+}
+
+// Ouvre le listing des tickets visibles par un technicien, d'ID > after et créés à partir
+// de since : tickets non assignés (listes OPEN et PRIORITY) et ceux qui lui sont assignés
+// Retourne -1 si la mémoire manque
+static int list_cursor_open_technician(list_cursor_t *c, uint32_t uid, uint32_t after, time_t since,
+                                       uint32_t limit, const char *resume) {
+    list_source_t src[3] = {
+        { state_list(OPEN), offsetof(ticket_hot_t, state_link), OPEN },
+        { state_list(PRIORITY), offsetof(ticket_hot_t, state_link), PRIORITY },
+        { &user_at(uid)->assigned, offsetof(ticket_hot_t, tech_link), -1 },
+    };
+    list_range_t r = { after, since, limit ? limit + 1 : 0, -1 };
+
+    memset(c, 0, sizeof(*c));
+    c->uid = uid;
+    memcpy(c->name, user_at(uid)->name, MAX_USER);
+    c->limit = limit;
+    c->technician = 1;
+    c->verb = "list";
+    c->resume = strdup(resume);
+    if (!c->resume) return -1;
+    return list_cursor_collect(c, src, 3, r);
+}
+
+// Ouvre le listing de tous les tickets des états demandés (bits 1 << état), d'ID > after
+// et créés à partir de since : seules les listes de ces états sont parcourues
+// Retourne -1 si la mémoire manque
+static int list_cursor_open_states(list_cursor_t *c, uint32_t uid, uint32_t states, uint32_t after,
+                                   time_t since, uint32_t limit, const char *resume) {
+    list_source_t src[4];
+    list_range_t r = { after, since, limit ? limit + 1 : 0, -1 };
+    int n = 0;
+
+    memset(c, 0, sizeof(*c));
+    c->uid = uid;
+    memcpy(c->name, user_at(uid)->name, MAX_USER);
+    c->limit = limit;
+    c->technician = 1;
+    c->all = 1;
+    c->states = states;
+    c->verb = "list";
+    c->resume = strdup(resume);
+    if (!c->resume) return -1;
+    for (int k = 0; k < 4; k++) {
+        if (!(states & (1u << k))) continue;
+        src[n].head = state_list((ticket_state_t)k);
+        src[n].link_off = offsetof(ticket_hot_t, state_link);
+        src[n++].state = k;
+    }
+    return list_cursor_collect(c, src, n, r);
+}
+
+static void list_cursor_close(list_cursor_t *c) {
+    free(c->refs);
+    free(c->resume);
+    c->refs = NULL;
+    c->resume = NULL;
+}
+
+// Met en forme les tickets suivants du listing dans buf (au moins LIST_ENTRY_MAX octets),
+// sans couper de ticket ; le dernier morceau se termine par le message de fin du listing
+// Retourne le nombre d'octets écrits
+static size_t list_cursor_fill(list_cursor_t *c, char *buf, size_t cap) {
+    size_t len = 0;
+
+    if (c->finished) return 0;
+    if (g_cfg.global_lock) index_lock();
+
+    while (c->pos < c->count && (c->limit == 0 || c->shown < c->limit) && cap - len >= LIST_ENTRY_MAX) {
+        slot_ref_t ref = c->refs[c->pos++];
+        list_line_t line;
+        size_t n = list_line_get(&ref, c->technician, buf + len, &line);
+        c->last_id = ref.id;
+        // Slot réutilisé depuis le relevé de la liste
+        if (line.id != ref.id) continue;
+        // Vue propriétaire : ticket d'un autre ; vue technicien : ticket pris par un autre depuis le relevé
+        if (!c->technician && line.owner_uid != c->uid) continue;
+        if (c->technician && !c->all && line.tech_uid != 0 && line.tech_uid != c->uid + 1) continue;
+        // État changé depuis le relevé
+        if (c->states && !(c->states & (1u << line.state))) continue;
+        len += n;
+        c->shown++;
+    }
+    if (g_cfg.global_lock) index_unlock();
+
+    // Fin du listing : message si rien n'a été affiché, reprise si la limite (ou la coupure
+    // du relevé) laisse des tickets après le dernier examiné
+    int rest = c->pos < c->count;
+    int more = rest || c->truncated;
+    size_t tail = LIST_ENTRY_MAX + (c->resume ? strlen(c->resume) : 0);
+    if ((!rest || (c->limit != 0 && c->shown == c->limit)) && cap - len >= tail) {
+        if (more)
+            len += (size_t)snprintf(buf + len, cap - len, "Suite : %s --after %u --limit %u%s\n",
+                c->verb, c->last_id, c->limit, c->resume ? c->resume : "");
+        else if (c->shown == 0 && c->search)
+            len += (size_t)snprintf(buf + len, cap - len, "Aucun ticket ne correspond à la recherche.\n");
+        else if (c->shown == 0)
+            len += (size_t)snprintf(buf + len, cap - len,
+                c->technician ? "Aucun ticket à afficher.\n" : "Aucun ticket pour %s\n", c->name);
+        c->finished = 1;
+    }
+    return len;
+}
+
+// Lit le masque des états d'une liste "OPEN,PRIORITY,..."
+// Retourne -1 si un état est inconnu
+static int parse_states(const char *spec, uint32_t *states) {
+    static const char *names[] = { "OPEN", "IN_PROGRESS", "CLOSED", "PRIORITY" };
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "%s", spec);
+    *states = 0;
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int k = 0;
+        while (k < 4 && strcasecmp(tok, names[k]) != 0) k++;
+        if (k == 4) return -1;
+        *states |= 1u << k;
+    }
+    return *states ? 0 : -1;
+}
+
+// Lit un entier non signé de 32 bits écrit en décimal (chiffres seuls, sans signe)
+// Retourne -1 si le texte n'en est pas un ou dépasse UINT32_MAX
+static int parse_u32(const char *text, uint32_t *out) {
+    char *end;
+
+    if (*text < '0' || *text > '9') return -1;
+    errno = 0;
+    unsigned long long val = strtoull(text, &end, 10);
+    if (errno == ERANGE || *end != '\0' || val > UINT32_MAX) return -1;
+    *out = (uint32_t)val;
+    return 0;
+}
+
+// Lit les options --after <id> et --limit N d'un listing
+// Retourne -1 si la syntaxe est invalide
+static int parse_list_args(const char *args, uint32_t *after, uint32_t *limit) {
+    char opt[16], val[64];
+    int used;
+
+    *after = 0;
+    *limit = 0;
+    while (sscanf(args, " %15s %63s%n", opt, val, &used) == 2) {
+        if (strcmp(opt, "--after") == 0) {
+            if (parse_u32(val, after) != 0) return -1;
+        } else if (strcmp(opt, "--limit") == 0) {
+            if (parse_u32(val, limit) != 0) return -1;
+        } else {
+            return -1;
+        }
+        args += used;
+    }
+    while (*args == ' ') args++;
+    return *args == '\0' ? 0 : -1;
+}
+
+// Lit une date : secondes depuis l'epoch, ou AAAA-MM-JJ[THH:MM[:SS]] en heure locale
+// Retourne -1 si la date est invalide
+static int parse_since(const char *spec, time_t *since) {
+    static const char *formats[] = { "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d" };
+    char *end;
+
+    unsigned long long secs = strtoull(spec, &end, 10);
+    if (end != spec && *end == '\0') {
+        *since = (time_t)secs;
+        return 0;
+    }
+    for (size_t k = 0; k < sizeof(formats) / sizeof(formats[0]); k++) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        end = strptime(spec, formats[k], &tm);
+        if (!end || *end != '\0') continue;
+        tm.tm_isdst = -1;
+        *since = mktime(&tm);
+        return *since == (time_t)-1 ? -1 : 0;
+    }
+    return -1;
+}
+
+// Lit les options du listing technicien "[--state S[,S]] [--since <date>] [--after <id>] [--limit N]" ;
+// resume reçoit ce qu'il faut rappeler pour la page suivante (filtre d'états et date)
+// Retourne -1 si la syntaxe est invalide
+static int parse_tech_list_args(const char *args, uint32_t *states, time_t *since, uint32_t *after,
+                                uint32_t *limit, char *resume, size_t resume_len) {
+    char opt[16], val[64];
+    int used;
+
+    *states = 0;
+    *since = 0;
+    *after = 0;
+    *limit = 0;
+    while (sscanf(args, " %15s %63s%n", opt, val, &used) == 2) {
+        if (strcmp(opt, "--state") == 0) {
+            if (parse_states(val, states) != 0) return -1;
+        } else if (strcmp(opt, "--since") == 0) {
+            if (parse_since(val, since) != 0) return -1;
+        } else if (strcmp(opt, "--after") == 0) {
+            if (parse_u32(val, after) != 0) return -1;
+        } else if (strcmp(opt, "--limit") == 0) {
+            if (parse_u32(val, limit) != 0) return -1;
+        } else {
+            return -1;
+        }
+        args += used;
+    }
+    while (*args == ' ') args++;
+    if (*args != '\0') return -1;
+
+    // Les états sont rappelés sous leur nom, la date en secondes (exacte quel que soit le format lu)
+    static const char *names[] = { "OPEN", "IN_PROGRESS", "CLOSED", "PRIORITY" };
+    size_t len = 0;
+    resume[0] = '\0';
+    for (int k = 0; k < 4; k++)
+        if (*states & (1u << k))
+            len += (size_t)snprintf(resume + len, resume_len - len, "%s%s",
+                                    len ? "," : " --state ", names[k]);
+    if (*since)
+        snprintf(resume + len, resume_len - len, " --since %lld", (long long)*since);
+    return 0;
+}
+
+/* -------------------
+ * Recherche (commande search) : les termes sont combinés par ET, "OR" entre deux
+ * termes accepte l'un ou l'autre (a OR b c = (a ou b) et c)
+ * ------------------- */
+
+// Requête découpée en termes, chacun rattaché à sa clause (groupe OR)
+typedef struct {
+    char terms[SEARCH_MAX_TERMS][SEARCH_TERM_MAX];
+    int clause[SEARCH_MAX_TERMS];
+    int nterms;
+    int nclauses;
+} search_query_t;
+
+// Liste de postings relevée sous search_seq
+typedef struct {
+    uint64_t postings;
+    uint32_t bytes;
+    uint32_t count;
+} search_ref_t;
+
+// Découpe le texte de la requête ; un mot qui donne plusieurs termes ("wi-fi") les exige tous
+// Retourne -1 si la requête est vide, trop longue ou mal formée
+static int search_parse_query(const char *p, search_query_t *q) {
+    char word[MAX_LINE];
+    int used, or_next = 0;
+
+    q->nterms = q->nclauses = 0;
+    while (sscanf(p, " %4095s%n", word, &used) == 1) {
+        p += used;
+        if (strcmp(word, "OR") == 0) {
+            if (q->nterms == 0 || or_next) return -1;
+            or_next = 1;
+            continue;
+        }
+        char term[SEARCH_TERM_MAX];
+        const char *w = word;
+        while ((w = search_next_term(w, term)) != NULL) {
+            if (q->nterms == SEARCH_MAX_TERMS) return -1;
+            if (!or_next) q->nclauses++;
+            or_next = 0;
+            memcpy(q->terms[q->nterms], term, SEARCH_TERM_MAX);
+            q->clause[q->nterms++] = q->nclauses - 1;
+        }
+    }
+    return q->nterms == 0 || or_next ? -1 : 0;
+}
+
+// Lit "[--state S[,S]] [--after <id>] [--limit N] termes" ; resume reçoit ce qu'il faut
+// rappeler pour la page suivante (filtre d'états et termes)
+// Retourne -1 si la syntaxe est invalide
+static int parse_search_args(const char *args, search_query_t *q, uint32_t *states,
+                             uint32_t *after, uint32_t *limit, char *resume, size_t resume_len) {
+    char opt[16], val[64];
+    int used;
+
+    *states = 0;
+    *after = 0;
+    *limit = SEARCH_DEFAULT_LIMIT;
+    resume[0] = '\0';
+    while (sscanf(args, " %15s %63s%n", opt, val, &used) == 2 && strncmp(opt, "--", 2) == 0) {
+        if (strcmp(opt, "--state") == 0) {
+            if (parse_states(val, states) != 0) return -1;
+            snprintf(resume, resume_len, " --state %s", val);
+        } else if (strcmp(opt, "--after") == 0) {
+            if (parse_u32(val, after) != 0) return -1;
+        } else if (strcmp(opt, "--limit") == 0) {
+            if (parse_u32(val, limit) != 0) return -1;
+        } else {
+            return -1;
+        }
+        args += used;
+    }
+    while (*args == ' ') args++;
+    size_t len = strlen(resume);
+    snprintf(resume + len, resume_len - len, " %s", args);
+    return search_parse_query(args, q);
+}
+
+// Décode une liste de postings dans out (r->count cases) ; retourne le nombre d'ID
+static uint32_t search_decode(const search_ref_t *r, uint32_t *out) {
+    const uint8_t *p = (const uint8_t*)g_shm + r->postings;
+    const uint8_t *end = p + r->bytes;
+    uint32_t id = 0, n = 0;
+
+    while (p < end && n < r->count) {
+        uint32_t gap = 0;
+        for (int shift = 0; p < end; shift += 7) {
+            uint8_t b = *p++;
+            gap |= (uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) break;
+        }
+        id += gap;
+        out[n++] = id;
+    }
+    return n;
+}
+
+// Union de deux listes d'ID croissants dans dst (taille na + nb)
+static uint32_t ids_union(const uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb, uint32_t *dst) {
+    uint32_t i = 0, j = 0, n = 0;
+
+    while (i < na || j < nb) {
+        if (j >= nb || (i < na && a[i] < b[j])) dst[n++] = a[i++];
+        else if (i >= na || b[j] < a[i]) dst[n++] = b[j++];
+        else { dst[n++] = a[i++]; j++; }
+    }
+    return n;
+}
+
+// Intersection de deux listes d'ID croissants, écrite dans a
+static uint32_t ids_intersect(uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb) {
+    uint32_t i = 0, j = 0, n = 0;
+
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (b[j] < a[i]) j++;
+        else { a[n++] = a[i++]; j++; }
+    }
+    return n;
+}
+
+// Tickets de la clause k : union des listes de ses termes (NULL si la mémoire manque)
+static uint32_t *search_clause_ids(const search_query_t *q, const search_ref_t *refs, int k, uint32_t *count) {
+    uint32_t total = 0;
+    for (int i = 0; i < q->nterms; i++)
+        if (q->clause[i] == k) total += refs[i].count;
+
+    uint32_t *ids = malloc(sizeof(*ids) * (total + 1));
+    uint32_t *term = malloc(sizeof(*term) * (total + 1));
+    uint32_t *tmp = malloc(sizeof(*tmp) * (total + 1));
+    uint32_t n = 0;
+    if (ids && term && tmp) {
+        for (int i = 0; i < q->nterms; i++) {
+            if (q->clause[i] != k) continue;
+            uint32_t m = search_decode(&refs[i], term);
+            n = ids_union(ids, n, term, m, tmp);
+            memcpy(ids, tmp, sizeof(*ids) * n);
+        }
+    } else {
+        free(ids);
+        ids = NULL;
+    }
+    free(term);
+    free(tmp);
+    *count = n;
+    return ids;
+}
+
+// Ouvre le listing des tickets qui correspondent à la requête, d'ID > after et dans les
+// états demandés (0 = tous), pour la vue technicien (tous les tickets). Seuls les ID des
+// listes de postings sont parcourus ; l'état n'est lu que jusqu'à limit+1 résultats.
+// Retourne -1 si la mémoire manque
+static int list_cursor_open_search(list_cursor_t *c, const search_query_t *q, uint32_t states,
+                                   uint32_t after, uint32_t limit, const char *resume) {
+    search_ref_t refs[SEARCH_MAX_TERMS];
+
+    memset(c, 0, sizeof(*c));
+    c->limit = limit;
+    c->technician = 1;
+    c->all = 1;
+    c->search = 1;
+    c->states = states;
+    c->verb = "search";
+    c->resume = strdup(resume);
+    if (!c->resume) return -1;
+
+    if (g_cfg.global_lock) index_lock();
+
+    // Listes des termes relevées d'un coup (un terme absent donne une liste vide)
+    while (1) {
+        uint32_t s = seq_read_begin(&g_shm->search_seq);
+        for (int i = 0; i < q->nterms; i++) {
+            const search_term_t *e = search_find(q->terms[i]);
+            refs[i].postings = e ? e->postings : 0;
+            refs[i].bytes = e ? e->bytes : 0;
+            refs[i].count = e ? e->count : 0;
+        }
+        if (!seq_read_retry(&g_shm->search_seq, s)) break;
+        sched_yield();
+    }
+
+    // Intersection des clauses, de la plus courte à la plus longue
+    uint32_t *ids = NULL, n = 0;
+    int rc = 0;
+    uint32_t *clause_ids[SEARCH_MAX_TERMS];
+    uint32_t clause_n[SEARCH_MAX_TERMS];
+    for (int k = 0; k < q->nclauses; k++) {
+        clause_ids[k] = search_clause_ids(q, refs, k, &clause_n[k]);
+        if (!clause_ids[k]) rc = -1;
+    }
+    for (int done = 0; rc == 0 && done < q->nclauses; done++) {
+        int best = -1;
+        for (int k = 0; k < q->nclauses; k++)
+            if (clause_ids[k] && (best < 0 || clause_n[k] < clause_n[best])) best = k;
+        if (!ids) {
+            ids = clause_ids[best];
+            n = clause_n[best];
+        } else {
+            n = ids_intersect(ids, n, clause_ids[best], clause_n[best]);
+            free(clause_ids[best]);
+        }
+        clause_ids[best] = NULL;
+    }
+    for (int k = 0; k < q->nclauses; k++) free(clause_ids[k]);
+
+    // Tickets encore présents, dans les états demandés, à partir de after
+    if (rc == 0) {
+        uint32_t want = limit ? limit + 1 : n;
+        uint32_t lo = 0, hi = n;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (ids[mid] <= after) lo = mid + 1;
+            else hi = mid;
+        }
+        c->refs = malloc(sizeof(*c->refs) * (want + 1));
+        if (!c->refs) rc = -1;
+        for (uint32_t i = lo; rc == 0 && i < n && c->count < want; i++) {
+            int64_t slot = id_index_find(ids[i]);
+            if (slot < 0) continue;
+            ticket_hot_t *t = ticket_at((uint32_t)slot);
+            if (__atomic_load_n(&t->id, __ATOMIC_RELAXED) != ids[i]) continue;
+            if (states && !(states & (1u << __atomic_load_n(&t->state, __ATOMIC_RELAXED)))) continue;
+            c->refs[c->count].slot = (uint32_t)slot;
+            c->refs[c->count++].id = ids[i];
+        }
+    }
+    free(ids);
+
+    if (g_cfg.global_lock) index_unlock();
+    return rc;
+}
+
+// Compte les tickets pris par un technicien (compteur tenu à jour par ticket_assign/ticket_close)
+static int count_assigned_to_technician(uint32_t uid) {
+    return (int)__atomic_load_n(&user_at(uid)->in_progress, __ATOMIC_RELAXED);
+}
+
+// Assigne le ticket au technicien uid et le passe IN_PROGRESS
+// Retourne -2 si le ticket est clos
+// Appelant : index_lock verrouillé
+static int ticket_assign(uint32_t slot, uint32_t uid) {
+    ticket_hot_t *t = ticket_at(slot);
+
+    ticket_write_begin(slot);
+    if (t->state == CLOSED) {
+        ticket_write_end(slot);
+        return -2;
+    }
+
+    // Retire le ticket au technicien précédent
+    if (t->tech_uid) {
+        user_entry_t *p = user_at(t->tech_uid - 1);
+        if (t->state == IN_PROGRESS) __atomic_fetch_sub(&p->in_progress, 1, __ATOMIC_RELAXED);
+        list_remove(&p->assigned, slot, offsetof(ticket_hot_t, tech_link));
+        tech_update(t->tech_uid - 1);
+    }
+
+    // Le ticket quitte la file d'escalade ou la file prioritaire (déjà IN_PROGRESS : il y reste)
+    if (t->state != IN_PROGRESS) {
+        list_remove(state_list(t->state), slot, offsetof(ticket_hot_t, state_link));
+        list_insert_sorted(state_list(IN_PROGRESS), slot, offsetof(ticket_hot_t, state_link));
+    }
+
+    user_entry_t *u = user_at(uid);
+    t->tech_uid = uid + 1;
+    t->state = IN_PROGRESS;
+    __atomic_fetch_add(&u->in_progress, 1, __ATOMIC_RELAXED);
+    tech_update(uid);
+    list_insert_sorted(&u->assigned, slot, offsetof(ticket_hot_t, tech_link));
+    wal_log_assign(t->id, u->name);
+    audit_log(AUDIT_ASSIGN, t->id, u->name, NULL);
+    change_publish(t->id, IN_PROGRESS, t->tech_uid);
+
+    ticket_write_end(slot);
+    return 0;
+}
+
+// Clôture le ticket : il passe dans la liste CLOSED et reste dans celle de son technicien
+// Appelant : index_lock verrouillé, ticket_write_begin(slot) fait
+static void ticket_close(uint32_t slot) {
+    ticket_hot_t *t = ticket_at(slot);
+
+    if (t->state == CLOSED) return; // Déjà clos : ni journal ni notification en double
+    if (t->state == IN_PROGRESS && t->tech_uid) {
+        __atomic_fetch_sub(&user_at(t->tech_uid - 1)->in_progress, 1, __ATOMIC_RELAXED);
+        tech_update(t->tech_uid - 1);
+    }
+    list_remove(state_list(t->state), slot, offsetof(ticket_hot_t, state_link));
+    list_insert_sorted(state_list(CLOSED), slot, offsetof(ticket_hot_t, state_link));
+    t->state = CLOSED;
+    wal_log_state(WAL_CLOSE, t->id);
+    audit_log(AUDIT_CLOSE, t->id, t->tech_uid ? user_at(t->tech_uid - 1)->name : NULL, NULL);
+    change_publish(t->id, CLOSED, t->tech_uid);
+}
+
+// Répartition : assigne les tickets en attente, du plus ancien au plus récent (PRIORITY,
+// puis OPEN avec --dispatch-open), chacun au technicien connecté le moins chargé qui a
+// encore de la place. Appelée dès qu'un ticket devient prioritaire ou qu'un technicien
+// se connecte ou libère de la place.
+// Retourne le nombre de tickets assignés
+// Appelant : index_lock verrouillé
+static int dispatch_run(void) {
+    int assigned = 0;
+
+    while (g_shm->tech_heap_len > 0) {
+        list_head_t *q = state_list(PRIORITY);
+        if (q->head == 0 && g_cfg.dispatch_open) q = state_list(OPEN);
+        if (q->head == 0) break;
+
+        uint32_t slot = q->head - 1;
+        ticket_hot_t *t = ticket_at(slot);
+        // En attente depuis son passage en PRIORITY (son échéance, à la seconde exacte), ou
+        // depuis sa création (date à la seconde près : attente comptée en secondes entières)
+        int priority = t->state == PRIORITY;
+        time_t ready = priority ? t->created + PRIORITY_SECONDS : t->created;
+        if (ticket_assign(slot, tech_heap()[0]) != 0) break;
+        assigned++;
+
+        if (t_stats) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            int64_t wait = ((int64_t)ts.tv_sec - ready) * 1000000000 + (priority ? ts.tv_nsec : 0);
+            uint64_t ns = wait > 0 ? (uint64_t)wait : 0, ms = ns / 1000000;
+            int b = ms == 0 ? 0 : 64 - __builtin_clzll(ms);
+            if (b >= STATS_BUCKETS) b = STATS_BUCKETS - 1;
+            stat_add(&t_stats->dispatched, 1);
+            stat_add(&t_stats->dispatch_wait_ns, ns);
+            stat_max(&t_stats->dispatch_wait_max, ns);
+            stat_add(&t_stats->dispatch_wait[b], 1);
+        }
+    }
+    return assigned;
+}
+
+// Passe en PRIORITY les tickets OPEN dont l'échéance est atteinte
+// Retourne l'échéance suivante (0 si la file est vide)
+// Appelant : index_lock verrouillé
+static time_t escalate_due_tickets(time_t now) {
+    while (state_list(OPEN)->head != 0) {
+        uint32_t slot = state_list(OPEN)->head - 1;
+        ticket_hot_t *t = ticket_at(slot);
+        time_t due = t->created + PRIORITY_SECONDS;
+
+        // La file est dans l'ordre de création : la tête a l'échéance la plus proche
+        if (due > now) return due;
+        ticket_write_begin(slot);
+        list_remove(state_list(OPEN), slot, offsetof(ticket_hot_t, state_link));
+        list_append(state_list(PRIORITY), slot, offsetof(ticket_hot_t, state_link));
+        t->state = PRIORITY;
+        wal_log_state(WAL_ESCALATE, t->id);
+        audit_log(AUDIT_ESCALATE, t->id, NULL, NULL);
+        change_publish(t->id, PRIORITY, 0);
+        ticket_write_end(slot);
+    }
+    return 0;
+}
+
+// Thread d'escalade : dort jusqu'à la prochaine échéance de la file OPEN
+static void *escalator_thread(void *arg) {
+    (void)arg;
+    stats_attach();
+
+    while (1) {
+        index_lock();
+        time_t now = time(NULL);
+        time_t next = escalate_due_tickets(now);
+        dispatch_run();
+        index_unlock();
+        wal_sync(t_wal_lsn);
+
+        // Les insertions d'autres processus sont prises en charge par leur propre thread :
+        // le réveil périodique ne sert que de filet de sécurité
+        struct timespec deadline = { now + ESCALATOR_MAX_SLEEP, 0 };
+        if (next != 0 && next < deadline.tv_sec) deadline.tv_sec = next;
+
+        pthread_mutex_lock(&g_escalator_lock);
+        pthread_cond_timedwait(&g_escalator_cond, &g_escalator_lock, &deadline);
+        pthread_mutex_unlock(&g_escalator_lock);
+    }
+    return NULL;
+}
+
+// Recherche d’un ticket par ID : dans le stockage (temps constant via l'index), sinon
+// dans les archives ; le ticket est copié dans out s'il n'est pas NULL
+// Retourne son slot, -2 s'il est archivé, -1 s'il n'existe pas
+static int64_t find_ticket_by_id(uint32_t id, ticket_t *out) {
+    if (id == 0 || id == ID_TOMBSTONE) return -1;
+    int64_t slot = id_index_find(id);
+    if (slot >= 0) {
+        if (out) ticket_read((uint32_t)slot, out);
+        if (!out || out->id == id) return slot;
+    }
+    const archive_record_t *r = archive_locate(id, NULL);
+    if (!r) return -1;
+    if (out) archive_copy(r, out);
+    return -2;
+}
+
+/* -------------------
+ * Reprise : point de reprise (snapshot) + rejeu du journal
+ * ------------------- */
+
+// Recrée un ticket lu sur disque (rien si l'ID existe déjà) ; les listes et compteurs
+// sont refaits ensuite par store_rebuild_indexes
+// Appelant : index_lock verrouillé
+static void store_restore_ticket(const ticket_t *src) {
+    if (id_index_find(src->id) >= 0) return;
+
+    int64_t owner = user_intern(src->owner);
+    int64_t tech = src->technician[0] ? user_intern(src->technician) : -1;
+    uint64_t text = ticket_text_store(src->title, src->desc);
+    int64_t slot = owner >= 0 && (tech >= 0 || !src->technician[0]) && text != 0 &&
+                   id_index_reserve() == 0 ? alloc_ticket_slot() : -1;
+    if (slot < 0)
+        perror_exit("Stockage plein pendant la reprise");
+    ticket_hot_t *t = ticket_at((uint32_t)slot);
+    t->id = src->id;
+    t->next_free = 0;
+    t->text = text;
+    t->owner_uid = (uint32_t)owner;
+    t->tech_uid = (uint32_t)(tech + 1);
+    t->state = src->state;
+    t->created = src->created;
+    id_index_insert(t->id, (uint32_t)slot);
+    g_shm->live_tickets++; // Utilisé par id_index_reserve pour dimensionner l'index
+    if (t->id >= g_shm->next_id) g_shm->next_id = t->id + 1;
+}
+
+// Replace l'avis n° pos dans l'anneau (sauf si un avis plus récent occupe déjà sa case)
+static void feedback_restore(uint64_t pos, const feedback_t *f) {
+    feedback_slot_t *slot = &feedback_ring()[pos % g_shm->feedback_cap];
+
+    if (slot->seq <= 2 * (pos + 1)) {
+        slot->f = *f;
+        slot->seq = 2 * (pos + 1);
+    }
+    if (g_shm->feedback_head < pos + 1) g_shm->feedback_head = pos + 1;
+}
+
+// Applique un enregistrement du journal (sans en-tête)
+// Retourne -1 si son contenu est invalide
+// Appelant : index_lock verrouillé (reprise)
+static int wal_replay_record(rbuf_t *r) {
+    ticket_t t;
+    feedback_t f;
+    int64_t slot;
+
+    memset(&t, 0, sizeof(t));
+    uint8_t type = get_u8(r);
+    switch (type) {
+        case WAL_INSERT:
+            t.id = get_u32(r);
+            t.created = (time_t)get_u64(r);
+            get_str(r, t.owner, MAX_USER);
+            get_str(r, t.title, MAX_TITLE);
+            get_str(r, t.desc, MAX_DESC);
+            t.state = OPEN;
+            if (r->err || t.id == 0) return -1;
+            store_restore_ticket(&t);
+            return 0;
+        case WAL_ASSIGN:
+            t.id = get_u32(r);
+            get_str(r, t.technician, MAX_USER);
+            if (r->err) return -1;
+            slot = id_index_find(t.id);
+            if (slot >= 0) {
+                int64_t tech = user_intern(t.technician);
+                if (tech < 0)
+                    perror_exit("Annuaire des utilisateurs plein pendant la reprise");
+                ticket_at((uint32_t)slot)->tech_uid = (uint32_t)tech + 1;
+                ticket_at((uint32_t)slot)->state = IN_PROGRESS;
+            }
+            return 0;
+        case WAL_CLOSE:
+        case WAL_ESCALATE:
+            t.state = type == WAL_CLOSE ? CLOSED : PRIORITY;
+            t.id = get_u32(r);
+            if (r->err) return -1;
+            slot = id_index_find(t.id);
+            if (slot >= 0) ticket_at((uint32_t)slot)->state = t.state;
+            return 0;
+        case WAL_FEEDBACK: {
+            uint64_t pos = get_u64(r);
+            memset(&f, 0, sizeof(f));
+            get_str(r, f.username, MAX_USER);
+            f.note_reactivite = (int)get_u32(r);
+            f.note_competence = (int)get_u32(r);
+            f.note_satisfaction = (int)get_u32(r);
+            if (r->err) return -1;
+            feedback_restore(pos, &f);
+            return 0;
+        }
+        case WAL_ARCHIVE:
+            t.id = get_u32(r);
+            get_u32(r);
+            if (r->err) return -1;
+            archive_replay(t.id);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+// Écrit une entrée du point de reprise en tenant le CRC à jour
+static int snapshot_put(FILE *fp, uint32_t *crc, const wbuf_t *b) {
+    *crc = crc32_update(*crc, b->data, b->len);
+    return fwrite(b->data, 1, b->len, fp) == b->len ? 0 : -1;
+}
+
+// Copie l'état dans le fichier path : en-tête (LSN, prochain ID), tickets un par un (lus
+// sous leur seqlock, sans bloquer les écrivains), avis, puis nombre de tickets et CRC
+// Retourne -1 en cas d'erreur d'écriture
+static int snapshot_write(const char *path, uint64_t lsn, uint64_t *count) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return -1;
+    setvbuf(fp, NULL, _IOFBF, 1 << 20);
+
+    uint32_t crc = 0;
+    int rc = 0;
+    wbuf_t b;
+    b.len = 0;
+    put_u32(&b, SNAPSHOT_MAGIC);
+    put_u32(&b, SNAPSHOT_VERSION);
+    put_u64(&b, lsn);
+    put_u32(&b, __atomic_load_n(&g_shm->next_id, __ATOMIC_RELAXED));
+    rc |= snapshot_put(fp, &crc, &b);
+
+    *count = 0;
+    uint32_t slots = __atomic_load_n(&g_shm->slot_count, __ATOMIC_ACQUIRE);
+    for (uint32_t slot = 0; slot < slots && rc == 0; slot++) {
+        ticket_t t;
+        // En mode verrou global, ticket_read suppose index_lock tenu
+        if (g_cfg.global_lock) index_lock();
+        ticket_read(slot, &t);
+        if (g_cfg.global_lock) index_unlock();
+        if (t.id == 0) continue;
+
+        b.len = 0;
+        put_u8(&b, 1);
+        put_u32(&b, t.id);
+        put_u8(&b, (uint8_t)t.state);
+        put_u64(&b, (uint64_t)t.created);
+        put_str(&b, t.owner, MAX_USER);
+        put_str(&b, t.technician, MAX_USER);
+        put_str(&b, t.title, MAX_TITLE);
+        put_str(&b, t.desc, MAX_DESC);
+        rc |= snapshot_put(fp, &crc, &b);
+        (*count)++;
+    }
+
+    uint64_t head = __atomic_load_n(&g_shm->feedback_head, __ATOMIC_ACQUIRE);
+    uint32_t cap = g_shm->feedback_cap;
+    for (uint64_t pos = head > cap ? head - cap : 0; pos < head && rc == 0; pos++) {
+        feedback_slot_t *slot = &feedback_ring()[pos % cap];
+        uint64_t s = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (s != 2 * (pos + 1)) continue;
+        feedback_t f = slot->f;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != s) continue;
+
+        b.len = 0;
+        put_u8(&b, 2);
+        put_u64(&b, pos);
+        put_str(&b, f.username, MAX_USER);
+        put_u32(&b, (uint32_t)f.note_reactivite);
+        put_u32(&b, (uint32_t)f.note_competence);
+        put_u32(&b, (uint32_t)f.note_satisfaction);
+        rc |= snapshot_put(fp, &crc, &b);
+    }
+
+    b.len = 0;
+    put_u8(&b, 0);
+    put_u64(&b, *count);
+    rc |= snapshot_put(fp, &crc, &b);
+    if (rc == 0 && fwrite(&crc, sizeof(crc), 1, fp) != 1) rc = -1;
+    if (fflush(fp) != 0 || fdatasync(fileno(fp)) == -1) rc = -1;
+    if (fclose(fp) != 0) rc = -1;
+    return rc;
+}
+
+// Charge le point de reprise : tickets et avis, LSN à partir duquel rejouer le journal
+// Un point de reprise illisible est fatal (le précédent n'existe plus)
+// Appelant : index_lock verrouillé (reprise)
+static void snapshot_load(uint64_t *lsn, uint64_t *count) {
+    int fd = open(g_cfg.snapshot_path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) == -1)
+        perror_exit("Erreur lors de l'ouverture du point de reprise");
+    size_t size = (size_t)st.st_size;
+    const unsigned char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (size && data == MAP_FAILED)
+        perror_exit("Erreur lors du mappage du point de reprise");
+
+    uint32_t crc = 0;
+    if (size >= sizeof(crc)) memcpy(&crc, data + size - sizeof(crc), sizeof(crc));
+    rbuf_t r = { data, size >= sizeof(crc) ? size - sizeof(crc) : 0, 0, size < sizeof(crc) };
+    if (r.err || crc32_update(0, data, r.len) != crc || get_u32(&r) != SNAPSHOT_MAGIC || get_u32(&r) != SNAPSHOT_VERSION) {
+        fprintf(stderr, "Point de reprise %s corrompu\n", g_cfg.snapshot_path);
+        exit(EXIT_FAILURE);
+    }
+    *lsn = get_u64(&r);
+    uint32_t next_id = get_u32(&r);
+    if (g_shm->next_id < next_id) g_shm->next_id = next_id;
+
+    for (int kind; !r.err && (kind = get_u8(&r)) != 0;) {
+        if (kind == 1) {
+            ticket_t t;
+            memset(&t, 0, sizeof(t));
+            t.id = get_u32(&r);
+            t.state = (ticket_state_t)get_u8(&r);
+            t.created = (time_t)get_u64(&r);
+            get_str(&r, t.owner, MAX_USER);
+            get_str(&r, t.technician, MAX_USER);
+            get_str(&r, t.title, MAX_TITLE);
+            get_str(&r, t.desc, MAX_DESC);
+            if (!r.err) store_restore_ticket(&t);
+        } else if (kind == 2) {
+            feedback_t f;
+            memset(&f, 0, sizeof(f));
+            uint64_t pos = get_u64(&r);
+            get_str(&r, f.username, MAX_USER);
+            f.note_reactivite = (int)get_u32(&r);
+            f.note_competence = (int)get_u32(&r);
+            f.note_satisfaction = (int)get_u32(&r);
+            if (!r.err) feedback_restore(pos, &f);
+        } else {
+            r.err = 1;
+        }
+    }
+    *count = get_u64(&r);
+    if (r.err) {
+        fprintf(stderr, "Point de reprise %s corrompu\n", g_cfg.snapshot_path);
+        exit(EXIT_FAILURE);
+    }
+    if (size) munmap((void*)data, size);
+    close(fd);
+}
+
+// Rejoue un segment à partir du LSN from ; un enregistrement incomplet ou dont le CRC
+// est faux marque la fin du journal (écriture interrompue) et le segment est tronqué là
+// Retourne le LSN de fin des enregistrements valides ; *torn = 1 si le segment a été tronqué
+static uint64_t wal_replay_segment(uint64_t start, uint64_t from, uint64_t *replayed, int *torn) {
+    char path[4096];
+    struct stat st;
+
+    wal_segment_path(start, path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) == -1)
+        perror_exit("Erreur lors de l'ouverture du journal");
+    size_t size = (size_t)st.st_size;
+    const unsigned char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (size && data == MAP_FAILED)
+        perror_exit("Erreur lors du mappage du journal");
+
+    size_t off = 0;
+    *torn = 0;
+    while (off < size) {
+        uint32_t len, crc;
+        if (size - off < 9) break;
+        memcpy(&len, data + off, sizeof(len));
+        memcpy(&crc, data + off + 4, sizeof(crc));
+        if (len < 9 || len > WAL_RECORD_MAX || len > size - off) break;
+        if (crc32_update(0, data + off + 8, len - 8) != crc) break;
+        if (start + off >= from) {
+            rbuf_t r = { data + off + 8, len - 8, 0, 0 };
+            if (wal_replay_record(&r) != 0) break;
+            (*replayed)++;
+        }
+        off += len;
+    }
+    if (off < size) {
+        *torn = 1;
+        if (ftruncate(fd, (off_t)off) == -1 || fsync(fd) == -1)
+            perror_exit("Erreur lors de la troncature du journal");
+    }
+    if (size) munmap((void*)data, size);
+    close(fd);
+    return start + off;
+}
+
+// Point de reprise : bascule le journal sur un nouveau segment au LSN L, copie l'état
+// ticket par ticket sans arrêter les écrivains, puis supprime les segments antérieurs à L.
+// Une modification déjà visible dans la copie mais de LSN ≥ L est rejouée à la reprise :
+// les enregistrements fixent des valeurs, le résultat est le même.
+// Retourne -1 si un autre point de reprise est en cours ou en cas d'erreur d'écriture
+static int checkpoint_run(void) {
+    struct timespec t0, t1;
+
+    // Un point de reprise interrompu par la mort de son processus n'a laissé qu'un fichier
+    // temporaire, réécrit par le suivant
+    int rc = pthread_mutex_trylock(&g_shm->ckpt_lock);
+    if (rc == EBUSY) return -1;
+    shm_mutex_taken(&g_shm->ckpt_lock, rc);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // Tout ce qui précède L est sur disque dans l'ancien segment
+    shm_mutex_lock(&g_shm->wal_lock);
+    while (g_shm->wal_flushing || g_shm->wal_durable != g_shm->wal_append) {
+        if (!g_shm->wal_flushing) wal_flush_locked();
+        else wal_wait_locked();
+    }
+    uint64_t lsn = g_shm->wal_append;
+    g_shm->wal_segment = lsn;
+    pthread_mutex_unlock(&g_shm->wal_lock);
+
+    char tmp[4096];
+    uint64_t count = 0;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_cfg.snapshot_path);
+    if (snapshot_write(tmp, lsn, &count) != 0 || rename(tmp, g_cfg.snapshot_path) == -1) {
+        perror("Erreur lors de l'écriture du point de reprise");
+        unlink(tmp);
+        pthread_mutex_unlock(&g_shm->ckpt_lock);
+        return -1;
+    }
+    fsync_parent_dir(g_cfg.snapshot_path);
+
+    uint64_t *segs;
+    int n = wal_list_segments(&segs);
+    for (int i = 0; i < n; i++) {
+        if (segs[i] >= lsn) continue;
+        char path[4096];
+        wal_segment_path(segs[i], path, sizeof(path));
+        unlink(path);
+    }
+    free(segs);
+
+    g_shm->ckpt_lsn = lsn;
+    g_shm->ckpt_time = time(NULL);
+    pthread_mutex_unlock(&g_shm->ckpt_lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("Point de reprise : %" PRIu64 " tickets au LSN %" PRIu64 " (%.1f ms)\n", count, lsn,
+        (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    return 0;
+}
+
+// Thread des points de reprise : un point de reprise dès que le journal dépasse
+// WAL_CHECKPOINT_BYTES (ce qui borne le rejeu au démarrage) ou après checkpoint_interval
+static void *checkpoint_thread(void *arg) {
+    (void)arg;
+    stats_attach();
+
+    while (1) {
+        sleep(1);
+        uint64_t pending = __atomic_load_n(&g_shm->wal_append, __ATOMIC_RELAXED) - g_shm->ckpt_lsn;
+        if (pending == 0) continue;
+        if (pending >= WAL_CHECKPOINT_BYTES || time(NULL) - g_shm->ckpt_time >= g_cfg.checkpoint_interval)
+            checkpoint_run();
+    }
+    return NULL;
+}
+
+// Reconstruit le stockage depuis le disque : point de reprise, puis segments du journal
+// dans l'ordre. Sans rien sur disque, l'état du fichier mappé sert de point de départ.
+// Appelant : seul processus, verrou de démarrage pris
+static void store_recover(void) {
+    struct timespec t0, t1;
+    struct stat st;
+    uint64_t *segs;
+    uint64_t snap_lsn = 0, snap_tickets = 0, replayed = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int n = wal_list_segments(&segs);
+    int has_snapshot = stat(g_cfg.snapshot_path, &st) == 0;
+
+    index_lock();
+    if (!has_snapshot && n == 0) {
+        store_rebuild_indexes();
+        g_shm->wal_append = g_shm->wal_durable = g_shm->wal_segment = 0;
+        index_unlock();
+        free(segs);
+        if (checkpoint_run() != 0)
+            perror_exit("Erreur lors du premier point de reprise");
+        return;
+    }
+
+    if (has_snapshot)
+        snapshot_load(&snap_lsn, &snap_tickets);
+
+    uint64_t end = snap_lsn, seg = snap_lsn;
+    int stop = 0;
+    for (int i = 0; i < n; i++) {
+        char path[4096];
+        wal_segment_path(segs[i], path, sizeof(path));
+        // Après une fin de journal ou un trou, les segments suivants ne peuvent pas être rejoués
+        if (!stop && ((i > 0 && segs[i] != end) || (i == 0 && segs[i] > snap_lsn))) {
+            fprintf(stderr, "Journal incomplet avant %s : la suite est ignorée\n", path);
+            stop = 1;
+        }
+        if (stop) {
+            unlink(path);
+            continue;
+        }
+        int torn;
+        end = wal_replay_segment(segs[i], snap_lsn, &replayed, &torn);
+        seg = segs[i];
+        if (torn) stop = 1;
+    }
+    if (end < snap_lsn) end = seg = snap_lsn;
+    free(segs);
+
+    store_rebuild_indexes();
+    g_shm->wal_append = g_shm->wal_durable = end;
+    g_shm->wal_segment = seg;
+    g_shm->ckpt_lsn = snap_lsn;
+    g_shm->ckpt_time = time(NULL);
+    uint32_t live = g_shm->live_tickets;
+    index_unlock();
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("Reprise : %" PRIu64 " tickets du point de reprise (LSN %" PRIu64 ") + %" PRIu64
+        " enregistrements rejoués, %u tickets en %.1f ms\n", snap_tickets, snap_lsn, replayed, live,
+        (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+}
+
+// Ouvre le stockage ; le premier processus le reconstruit depuis le disque
+static void store_open(void) {
+    int alone = shm_open_map();
+    // Abonnés et techniciens connectés des processus précédents, partis avec eux
+    if (alone) {
+        g_shm->watchers = 0;
+        g_shm->tech_online_used = 0;
+    }
+    // Segments d'archive relus avant le rejeu du journal (WAL_ARCHIVE y fait référence)
+    if (alone)
+        archive_load();
+    if (alone && g_cfg.wal_path)
+        store_recover();
+    // Dernier segment publié sans que son archivage ait été journalisé (arrêt brutal) :
+    // ses tickets sont encore dans le stockage
+    if (alone && g_shm->archive_count > 0)
+        archive_release(g_shm->archive_count - 1);
+    shm_startup_done();
+}
+
+/* -------------------
+ * Statistiques : rapport (commande STATS, vidage périodique)
+ * ------------------- */
+
+// Borne supérieure (µs) de la case où se trouve la fraction q des commandes
+static uint64_t stats_percentile(const uint64_t *hist, uint64_t total, double q) {
+    uint64_t rank = (uint64_t)(q * (double)total + 0.5), seen = 0;
+
+    if (rank == 0) rank = 1;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return 1ull << b;
+    }
+    return 1ull << (STATS_BUCKETS - 1);
+}
+
+static uint64_t stat_get(const uint64_t *c) {
+    return __atomic_load_n(c, __ATOMIC_RELAXED);
+}
+
+// Écrit le rapport : somme des blocs de tous les threads, puis occupation du stockage.
+// Les blocs sont lus pendant que leurs threads comptent : chaque compteur est exact,
+// l'ensemble est une photo à quelques commandes près.
+static void stats_report(FILE *fp) {
+    stats_block_t *sum = calloc(1, sizeof(*sum));
+    int64_t sessions = 0;
+    uint32_t threads = 0;
+
+    if (!sum) {
+        fprintf(fp, "Mémoire insuffisante pour les statistiques.\n");
+        return;
+    }
+    for (uint32_t i = 0; i < STATS_SLOTS; i++) {
+        stats_block_t *b = stats_block(i);
+        uint64_t o = __atomic_load_n(&b->owner, __ATOMIC_ACQUIRE);
+        if (o == 0) continue;
+        int alive = pid_alive((pid_t)(o >> 1));
+        if ((o & 1) && alive) threads++;
+        // Sessions des processus morts : fermées avec eux
+        if (alive) sessions += (int64_t)(stat_get(&b->sess_opened) - stat_get(&b->sess_closed));
+
+        for (int k = 0; k < CMD_COUNT; k++) {
+            sum->commands[k] += stat_get(&b->commands[k]);
+            sum->latency_ns[k] += stat_get(&b->latency_ns[k]);
+            for (int j = 0; j < STATS_BUCKETS; j++) sum->latency[k][j] += stat_get(&b->latency[k][j]);
+        }
+        for (int k = 0; k < LOCK_CLASSES; k++) {
+            lock_stats_t *d = &sum->locks[k], *l = &b->locks[k];
+            d->count += stat_get(&l->count);
+            d->contended += stat_get(&l->contended);
+            d->wait_ns += stat_get(&l->wait_ns);
+            d->hold_ns += stat_get(&l->hold_ns);
+            if (stat_get(&l->wait_max) > d->wait_max) d->wait_max = stat_get(&l->wait_max);
+            if (stat_get(&l->hold_max) > d->hold_max) d->hold_max = stat_get(&l->hold_max);
+        }
+        sum->durable_waits += stat_get(&b->durable_waits);
+        sum->durable_wait_ns += stat_get(&b->durable_wait_ns);
+        if (stat_get(&b->durable_wait_max) > sum->durable_wait_max) sum->durable_wait_max = stat_get(&b->durable_wait_max);
+        sum->accepted += stat_get(&b->accepted);
+        sum->bytes_in += stat_get(&b->bytes_in);
+        sum->bytes_out += stat_get(&b->bytes_out);
+        sum->audit_events += stat_get(&b->audit_events);
+        sum->audit_lost += stat_get(&b->audit_lost);
+        sum->audit_bytes += stat_get(&b->audit_bytes);
+        sum->dispatched += stat_get(&b->dispatched);
+        sum->dispatch_wait_ns += stat_get(&b->dispatch_wait_ns);
+        if (stat_get(&b->dispatch_wait_max) > sum->dispatch_wait_max) sum->dispatch_wait_max = stat_get(&b->dispatch_wait_max);
+        for (int j = 0; j < STATS_BUCKETS; j++) sum->dispatch_wait[j] += stat_get(&b->dispatch_wait[j]);
+        sum->watch_events += stat_get(&b->watch_events);
+        sum->watch_coalesced += stat_get(&b->watch_coalesced);
+        sum->watch_lost += stat_get(&b->watch_lost);
+        sum->list_cache_hits += stat_get(&b->list_cache_hits);
+        sum->list_cache_misses += stat_get(&b->list_cache_misses);
+    }
+
+    uint64_t fb_head = __atomic_load_n(&g_shm->feedback_head, __ATOMIC_RELAXED);
+    uint32_t fb_cap = __atomic_load_n(&g_shm->feedback_cap, __ATOMIC_RELAXED);
+    fprintf(fp, "Statistiques (%u thread(s) comptés)\n", threads);
+    fprintf(fp, "Connexions : %" PRId64 " ouverte(s), %" PRIu64 " acceptée(s) ; %" PRIu64 " octets reçus, %" PRIu64 " envoyés\n",
+            sessions, sum->accepted, sum->bytes_in, sum->bytes_out);
+    fprintf(fp, "Tickets : %u (slots %u, pages %u), prochain ID %u ; OPEN %u, PRIORITY %u, IN_PROGRESS %u, CLOSED %u ; %u utilisateur(s)\n",
+            __atomic_load_n(&g_shm->live_tickets, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->slot_count, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->slab_count, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->next_id, __ATOMIC_RELAXED),
+            __atomic_load_n(&state_list(OPEN)->count, __ATOMIC_RELAXED),
+            __atomic_load_n(&state_list(PRIORITY)->count, __ATOMIC_RELAXED),
+            __atomic_load_n(&state_list(IN_PROGRESS)->count, __ATOMIC_RELAXED),
+            __atomic_load_n(&state_list(CLOSED)->count, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->user_count, __ATOMIC_RELAXED));
+    fprintf(fp, "Archives : %u segment(s), %" PRIu64 " ticket(s), %.1f Mio",
+            __atomic_load_n(&g_shm->archive_count, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->archive_tickets, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->archive_bytes, __ATOMIC_RELAXED) / 1048576.0);
+    if (g_cfg.archive_after > 0) fprintf(fp, " ; tickets CLOSED archivés après %d s\n", g_cfg.archive_after);
+    else fprintf(fp, " ; archivage désactivé\n");
+    fprintf(fp, "Recherche : %u terme(s), %.1f Mio de listes de tickets\n",
+            __atomic_load_n(&g_shm->search_used, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->search_bytes, __ATOMIC_RELAXED) / 1048576.0);
+    fprintf(fp, "Avis : %" PRIu64 " conservé(s) sur %u ; mémoire partagée : %.1f Mio utilisés sur %.1f Mio\n",
+            fb_head < fb_cap ? fb_head : fb_cap, fb_cap,
+            __atomic_load_n(&g_shm->heap_top, __ATOMIC_RELAXED) / 1048576.0,
+            __atomic_load_n(&g_shm->file_size, __ATOMIC_RELAXED) / 1048576.0);
+    // Attente d'un ticket entre son passage en PRIORITY (ou sa création) et son assignation
+    fprintf(fp, "Répartition : %u session(s) de technicien, %u technicien(s) disponible(s) ; %" PRIu64
+            " ticket(s) assigné(s)",
+            __atomic_load_n(&g_shm->tech_online_count, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->tech_heap_len, __ATOMIC_RELAXED), sum->dispatched);
+    if (sum->dispatched)
+        fprintf(fp, ", attente moy %.1f ms, p50 <%" PRIu64 " ms, p99 <%" PRIu64 " ms, max %.1f ms",
+                sum->dispatch_wait_ns / 1e6 / (double)sum->dispatched,
+                stats_percentile(sum->dispatch_wait, sum->dispatched, 0.50),
+                stats_percentile(sum->dispatch_wait, sum->dispatched, 0.99),
+                sum->dispatch_wait_max / 1e6);
+    fputc('\n', fp);
+    fprintf(fp, "Suivi : %u abonné(s), %" PRIu64 " changement(s) publié(s) ; %" PRIu64 " envoyé(s), %" PRIu64
+            " regroupé(s), %" PRIu64 " perdu(s)\n",
+            __atomic_load_n(&g_shm->watchers, __ATOMIC_RELAXED),
+            __atomic_load_n(&g_shm->change_head, __ATOMIC_RELAXED),
+            sum->watch_events, sum->watch_coalesced, sum->watch_lost);
+    if (g_cfg.list_cache) {
+        uint64_t listed = sum->list_cache_hits + sum->list_cache_misses;
+        fprintf(fp, "Cache des listings : %" PRIu64 " ticket(s) repris, %" PRIu64 " mis en forme (%.1f %% repris)\n",
+                sum->list_cache_hits, sum->list_cache_misses, listed ? 100.0 * sum->list_cache_hits / listed : 0.0);
+    } else {
+        fprintf(fp, "Cache des listings : désactivé\n");
+    }
+    if (g_cfg.audit_path)
+        fprintf(fp, "Audit : %" PRIu64 " événement(s) écrit(s) (%.1f Mio), %" PRIu64 " perdu(s)\n",
+                sum->audit_events, sum->audit_bytes / 1048576.0, sum->audit_lost);
+    if (g_cfg.wal_path) {
+        uint64_t append = __atomic_load_n(&g_shm->wal_append, __ATOMIC_RELAXED);
+        uint64_t durable = __atomic_load_n(&g_shm->wal_durable, __ATOMIC_RELAXED);
+        fprintf(fp, "Journal : LSN %" PRIu64 ", %" PRIu64 " octets pas encore sur disque, dernier point de reprise au LSN %" PRIu64 "\n",
+                append, append > durable ? append - durable : 0, __atomic_load_n(&g_shm->ckpt_lsn, __ATOMIC_RELAXED));
+        fprintf(fp, "Attente du disque : %" PRIu64 " fois, moyenne %.1f µs, max %.1f µs\n",
+                sum->durable_waits, sum->durable_waits ? sum->durable_wait_ns / 1e3 / (double)sum->durable_waits : 0.0,
+                sum->durable_wait_max / 1e3);
+    } else {
+        fprintf(fp, "Journal : désactivé\n");
+    }
+
+    // Durée d'exécution de la commande, hors attente du disque et hors envoi des listings
+    fprintf(fp, "\n%-18s %10s %11s %11s %11s %11s\n", "Commande", "Nombre", "moy (µs)", "p50 (µs)", "p99 (µs)", "p999 (µs)");
+    for (int k = 0; k < CMD_COUNT; k++) {
+        uint64_t n = sum->commands[k];
+        if (n == 0) continue;
+        // Centiles : borne de la case de l'histogramme (puissance de 2)
+        char p[3][24];
+        const double q[3] = { 0.50, 0.99, 0.999 };
+        for (int j = 0; j < 3; j++)
+            snprintf(p[j], sizeof(p[j]), "<%" PRIu64, stats_percentile(sum->latency[k], n, q[j]));
+        fprintf(fp, "%-18s %10" PRIu64 " %10.1f %10s %10s %10s\n",
+                cmd_names[k], n, sum->latency_ns[k] / 1e3 / (double)n, p[0], p[1], p[2]);
+    }
+
+    fprintf(fp, "\n%-10s %13s %10s %15s %15s %15s %15s\n", "Verrou", "Acquisitions", "Attentes",
+            "attente moy", "attente max", "tenue moy", "tenue max (µs)");
+    for (int k = 0; k < LOCK_CLASSES; k++) {
+        lock_stats_t *l = &sum->locks[k];
+        fprintf(fp, "%-10s %13" PRIu64 " %10" PRIu64 " %15.2f %15.1f %15.2f %15.1f\n",
+                lock_names[k], l->count, l->contended,
+                l->contended ? l->wait_ns / 1e3 / (double)l->contended : 0.0, l->wait_max / 1e3,
+                l->count ? l->hold_ns / 1e3 / (double)l->count : 0.0, l->hold_max / 1e3);
+    }
+    free(sum);
+}
+
+// Thread de vidage : réécrit le fichier des statistiques toutes les stats_interval secondes
+// (fichier temporaire puis rename : un lecteur ne voit jamais de rapport à moitié écrit)
+static void *stats_thread(void *arg) {
+    char tmp[4096];
+    (void)arg;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_cfg.stats_path);
+    while (1) {
+        sleep((unsigned)g_cfg.stats_interval);
+
+        FILE *fp = fopen(tmp, "w");
+        if (!fp) {
+            perror("Erreur lors de l'écriture des statistiques");
+            continue;
+        }
+        char timebuf[64];
+        time_t now = time(NULL);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", &tm);
+        fprintf(fp, "# %s\n", timebuf);
+        stats_report(fp);
+        if (fclose(fp) != 0 || rename(tmp, g_cfg.stats_path) != 0)
+            perror("Erreur lors de l'écriture des statistiques");
+    }
+    return NULL;
+}
+
+/* -------------------
+ * Sessions clients
+ * ------------------- */
+
+// États d'une connexion (remplace la boucle bloquante de l'ancien client_thread)
+typedef enum {
+    SESS_COMMAND = 0,               // Attente d'une commande
+    SESS_BATCH,                     // Réception des lignes d'un lot (sendTicket -batch)
+    SESS_NOTE_REACTIVITE,           // Questionnaire de sortie : 1re note
+    SESS_NOTE_COMPETENCE,           // 2e note
+    SESS_NOTE_SATISFACTION,         // 3e note
+    SESS_CLOSING                    // Fermeture dès que la sortie est vidée
+} session_state_t;
+
+// Morceau de la file de sortie d'une session
+typedef struct out_chunk {
+    struct out_chunk *next;
+    size_t len;                     // Octets écrits dans data
+    size_t pos;                     // Octets déjà envoyés
+    char data[OUT_CHUNK];
+} out_chunk_t;
+
+// Texte d'un ticket lu avant la création (lot)
+typedef struct {
+    char title[MAX_TITLE];
+    char desc[MAX_DESC];
+} ticket_draft_t;
+
+// Lot de tickets en cours de réception : chaque ligne est lue à son arrivée,
+// les tickets sont tous créés sous un seul index_lock à la dernière
+typedef struct {
+    uint32_t expected;              // Lignes annoncées
+    uint32_t received;              // Lignes reçues
+    uint32_t count;                 // Tickets valides dans drafts
+    ticket_draft_t *drafts;
+    char *errors;                   // Lignes rejetées, un message par ligne (NULL = aucune)
+    size_t errors_len;
+} ticket_batch_t;
+
+// Abonnés d'un worker epoll (watch) : seul ce worker parcourt et modifie la liste
+typedef struct {
+    struct session *head;
+    uint32_t count;                 // Abonnés de la liste (lu par le thread de suivi)
+    int evfd;                       // eventfd par lequel le thread de suivi réveille le worker
+} watch_list_t;
+
+// Liste du worker epoll courant (NULL en mode threads : pas de watch)
+static __thread watch_list_t *t_watch = NULL;
+
+// État d'une connexion client
+typedef struct session {
+    int sock;
+    session_state_t state;
+    char username[MAX_USER];
+    uint32_t uid;                   // Entrée de l'utilisateur dans l'annuaire (une fois identifié)
+    int is_technician;
+    uint32_t online;                // Case de la session parmi les techniciens connectés + 1 (0 = aucune)
+    int notes[3];                   // Notes du questionnaire de sortie
+    int framed;                     // Réponses terminées par une ligne "." (FRAMING on)
+    int stuffing;                   // Réponse délimitée en cours : lignes commençant par '.' doublées
+    int out_bol;                    // La sortie est en début de ligne
+    int discarding;                 // Ligne trop longue : ignorée jusqu'au prochain \n
+    size_t inlen;                   // Octets reçus pas encore traités
+    char in[MAX_LINE];              // Début de la ligne en cours de réception
+    out_chunk_t *out_head;          // Réponses en attente d'envoi
+    out_chunk_t *out_tail;
+    size_t out_queued;              // Octets en attente dans la file
+    list_cursor_t *cursor;          // Listing en cours (NULL = aucun)
+    ticket_batch_t *batch;          // Lot en cours de réception (NULL = aucun)
+    int watching;                   // Abonné aux changements (watch) : une ligne reçue y met fin
+    uint32_t watch_states;          // États suivis (1 << état)
+    uint64_t watch_pos;             // Prochain changement à envoyer
+    uint32_t *watch_resync;         // Tickets à envoyer dans leur état actuel (retard regroupé)
+    uint32_t watch_resync_n;
+    uint32_t watch_resync_pos;
+    watch_list_t *watch_list;       // Liste des abonnés du worker
+    struct session *watch_next;
+    struct session **watch_pprev;
+} session_t;
+
+static session_t *session_new(int sock) {
+    session_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->sock = sock;
+    s->state = SESS_COMMAND;
+    if (t_stats) {
+        stat_add(&t_stats->accepted, 1);
+        stat_add(&t_stats->sess_opened, 1);
+    }
+    return s;
+}
+
+// Fin d'un abonnement (ligne reçue du client, déconnexion)
+static void watch_stop(session_t *s) {
+    if (!s->watching) return;
+    *s->watch_pprev = s->watch_next;
+    if (s->watch_next) s->watch_next->watch_pprev = s->watch_pprev;
+    __atomic_sub_fetch(&s->watch_list->count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&g_shm->watchers, 1, __ATOMIC_RELAXED);
+    free(s->watch_resync);
+    s->watch_resync = NULL;
+    s->watch_resync_n = s->watch_resync_pos = 0;
+    s->watching = 0;
+}
+
+static void session_free(session_t *s) {
+    if (t_stats) stat_add(&t_stats->sess_closed, 1);
+    watch_stop(s);
+    if (s->online) {
+        index_lock();
+        tech_online_remove(s->online);
+        index_unlock();
+    }
+    while (s->out_head) {
+        out_chunk_t *c = s->out_head;
+        s->out_head = c->next;
+        free(c);
+    }
+    if (s->cursor) {
+        list_cursor_close(s->cursor);
+        free(s->cursor);
+    }
+    if (s->batch) {
+        free(s->batch->drafts);
+        free(s->batch->errors);
+        free(s->batch);
+    }
+    free(s);
+}
+
+// Ajoute len octets à la file de sortie, tels quels
+static void session_write(session_t *s, const char *str, size_t len) {
+    while (len > 0) {
+        out_chunk_t *c = s->out_tail;
+        if (!c || c->len == OUT_CHUNK) {
+            c = malloc(sizeof(*c));
+            if (!c) return; // Réponse perdue, la connexion reste utilisable
+            c->next = NULL;
+            c->len = c->pos = 0;
+            if (s->out_tail) s->out_tail->next = c;
+            else s->out_head = c;
+            s->out_tail = c;
+        }
+        size_t n = OUT_CHUNK - c->len < len ? OUT_CHUNK - c->len : len;
+        memcpy(c->data + c->len, str, n);
+        c->len += n;
+        s->out_queued += n;
+        str += n;
+        len -= n;
+    }
+}
+
+// Ajoute len octets aux réponses en attente du client
+// (dans une réponse délimitée, les lignes commençant par '.' sont doublées)
+static void session_append(session_t *s, const char *str, size_t len) {
+    if (len == 0) return;
+    if (!s->stuffing) {
+        session_write(s, str, len);
+        s->out_bol = str[len-1] == '\n';
+        return;
+    }
+    for (size_t i = 0; i < len;) {
+        const char *nl = memchr(str + i, '\n', len - i);
+        size_t end = nl ? (size_t)(nl - str) + 1 : len;
+        if (s->out_bol && str[i] == '.') session_write(s, ".", 1);
+        session_write(s, str + i, end - i);
+        s->out_bol = nl != NULL;
+        i = end;
+    }
+}
+
+// Ajoute le message str aux réponses en attente du client
+static void sendall(session_t *s, const char *str) {
+    session_append(s, str, strlen(str));
+}
+
+// Envoie les réponses en attente, jusqu'à FLUSH_IOV morceaux par writev
+// Retourne 0 si tout est parti, 1 si le socket est plein (EAGAIN), -1 en cas d'erreur
+static int session_flush(session_t *s) {
+    while (s->out_head) {
+        struct iovec iov[FLUSH_IOV];
+        int cnt = 0;
+        for (out_chunk_t *c = s->out_head; c && cnt < FLUSH_IOV; c = c->next) {
+            iov[cnt].iov_base = c->data + c->pos;
+            iov[cnt].iov_len = c->len - c->pos;
+            cnt++;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)cnt;
+        ssize_t n = sendmsg(s->sock, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1;
+            return -1;
+        }
+        if (t_stats) stat_add(&t_stats->bytes_out, (uint64_t)n);
+
+        // Libère les morceaux envoyés, avance dans le morceau partiellement envoyé
+        s->out_queued -= (size_t)n;
+        while (n > 0) {
+            out_chunk_t *c = s->out_head;
+            size_t left = c->len - c->pos;
+            if ((size_t)n < left) { c->pos += (size_t)n; break; }
+            n -= (ssize_t)left;
+            s->out_head = c->next;
+            if (!s->out_head) s->out_tail = NULL;
+            free(c);
+        }
+    }
+    return 0;
+}
+
+// Démarre un listing : sa réponse est produite par session_pump à mesure que le client la lit
+static void session_start_listing(session_t *s, int technician, uint32_t states, time_t since,
+                                  uint32_t after, uint32_t limit, const char *resume) {
+    list_cursor_t *c = malloc(sizeof(*c));
+    int rc = -1;
+
+    if (c && !technician)
+        rc = list_cursor_open_owner(c, s->uid, after, limit);
+    else if (c && states)
+        rc = list_cursor_open_states(c, s->uid, states, after, since, limit, resume);
+    else if (c)
+        rc = list_cursor_open_technician(c, s->uid, after, since, limit, resume);
+    if (rc != 0) {
+        if (c) list_cursor_close(c);
+        free(c);
+        sendall(s, "Mémoire insuffisante pour le listing, réessayez plus tard.\n");
+        return;
+    }
+    s->cursor = c;
+}
+
+static void session_start_search(session_t *s, const search_query_t *q, uint32_t states,
+                                 uint32_t after, uint32_t limit, const char *resume) {
+    list_cursor_t *c = malloc(sizeof(*c));
+
+    if (!c || list_cursor_open_search(c, q, states, after, limit, resume) != 0) {
+        if (c) list_cursor_close(c);
+        free(c);
+        sendall(s, "Mémoire insuffisante pour la recherche, réessayez plus tard.\n");
+        return;
+    }
+    s->cursor = c;
+}
+
+/* -------------------
+ * Suivi des changements (watch) : l'abonné reçoit une ligne par changement publié depuis
+ * son abonnement, à mesure qu'il les lit. Sa file de sortie est bornée (WATCH_QUEUE_MAX) :
+ * au-delà, sa position dans l'anneau reste en arrière ; s'il a plus de WATCH_COALESCE
+ * changements de retard, chaque ticket concerné ne lui est plus envoyé qu'une fois, dans
+ * son état actuel.
+ * ------------------- */
+
+// Abonne la session aux changements des états states, à partir du prochain publié
+// Appelant : le worker epoll de la session
+static void watch_start(session_t *s, uint32_t states) {
+    watch_list_t *l = t_watch;
+
+    s->watching = 1;
+    s->watch_states = states;
+    s->watch_list = l;
+    s->watch_next = l->head;
+    s->watch_pprev = &l->head;
+    if (l->head) l->head->watch_pprev = &s->watch_next;
+    l->head = s;
+    __atomic_add_fetch(&l->count, 1, __ATOMIC_RELAXED);
+    // Compté avant de lire la position de départ : un écrivain qui publie ensuite voit
+    // l'abonné et réveille le thread de suivi (voir change_notify)
+    __atomic_add_fetch(&g_shm->watchers, 1, __ATOMIC_SEQ_CST);
+    s->watch_pos = __atomic_load_n(&g_shm->change_head, __ATOMIC_SEQ_CST);
+}
+
+// Envoie une ligne "quoi ID:n | ÉTAT | owner:x | tech:y | Title: ..." ; state < 0 : état
+// actuel du ticket (retard regroupé), sinon état et technicien au moment du changement
+static void watch_send(session_t *s, const char *what, uint32_t id, int state, uint32_t tech_uid) {
+    static const char *names[] = { "OPEN", "IN_PROGRESS", "CLOSED", "PRIORITY" };
+    char line[LIST_ENTRY_MAX];
+    ticket_t t;
+
+    if (find_ticket_by_id(id, &t) == -1) {
+        // Ticket disparu depuis : seul le changement lui-même est connu
+        if (state < 0) return;
+        snprintf(line, sizeof(line), "%s ID:%u | %s\n", what, id, names[state]);
+    } else {
+        if (state < 0) {
+            state = (int)t.state;
+        } else {
+            if (tech_uid) memcpy(t.technician, user_at(tech_uid - 1)->name, MAX_USER);
+            else t.technician[0] = '\0';
+        }
+        snprintf(line, sizeof(line), "%s ID:%u | %s | owner:%s | tech:%s | Title: %s\n",
+                 what, id, names[state], t.owner, t.technician[0] ? t.technician : "-", t.title);
+    }
+    sendall(s, line);
+    if (t_stats) stat_add(&t_stats->watch_events, 1);
+}
+
+static int id_cmp(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Regroupe le retard de l'abonné jusqu'à head : les tickets concernés (une fois chacun)
+// seront envoyés dans leur état actuel ; les changements déjà réécrits sont perdus
+static void watch_coalesce(session_t *s, uint64_t head) {
+    uint64_t from = s->watch_pos, lost = 0;
+    uint32_t n = 0;
+    char msg[160];
+
+    if (head - from > CHANGE_RING_SIZE) {
+        lost = head - CHANGE_RING_SIZE - from;
+        from = head - CHANGE_RING_SIZE;
+    }
+    free(s->watch_resync);
+    s->watch_resync = malloc(sizeof(uint32_t) * (head - from));
+    for (uint64_t i = from; s->watch_resync && i < head; i++) {
+        change_t c;
+        if (change_read(i, &c) != 0) { lost++; continue; }
+        if (s->watch_states & (1u << c.state)) s->watch_resync[n++] = c.id;
+    }
+    if (!s->watch_resync) lost = head - s->watch_pos;
+
+    // Un ticket par ID, dans l'ordre des ID
+    if (n > 1) qsort(s->watch_resync, n, sizeof(uint32_t), id_cmp);
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < n; i++)
+        if (k == 0 || s->watch_resync[i] != s->watch_resync[k-1]) s->watch_resync[k++] = s->watch_resync[i];
+    s->watch_resync_n = k;
+    s->watch_resync_pos = 0;
+
+    if (lost) {
+        snprintf(msg, sizeof(msg), "Suivi en retard : %" PRIu64 " changement(s) perdu(s), relancez list pour l'état complet\n", lost);
+        sendall(s, msg);
+    }
+    snprintf(msg, sizeof(msg), "Suivi en retard : %" PRIu64 " changement(s) regroupé(s) en %u ticket(s), état actuel :\n",
+             head - s->watch_pos - lost, k);
+    sendall(s, msg);
+    if (t_stats) {
+        stat_add(&t_stats->watch_coalesced, head - s->watch_pos - lost);
+        stat_add(&t_stats->watch_lost, lost);
+    }
+    s->watch_pos = head;
+}
+
+// Ajoute à la sortie de l'abonné les changements en attente, tant qu'elle reste sous WATCH_QUEUE_MAX
+// Retourne 1 s'il en reste (sortie pleine), 0 si l'abonné est à jour
+static int watch_fill(session_t *s) {
+    static const char *what[] = { "created", "taken", "closed", "escalated" };
+
+    while (s->out_queued < WATCH_QUEUE_MAX) {
+        // Tickets d'un retard regroupé
+        if (s->watch_resync_pos < s->watch_resync_n) {
+            watch_send(s, "update", s->watch_resync[s->watch_resync_pos++], -1, 0);
+            continue;
+        }
+        if (s->watch_resync) {
+            free(s->watch_resync);
+            s->watch_resync = NULL;
+            s->watch_resync_n = s->watch_resync_pos = 0;
+        }
+
+        uint64_t head = __atomic_load_n(&g_shm->change_head, __ATOMIC_ACQUIRE);
+        change_t c;
+        if (s->watch_pos == head) return 0;
+        if (head - s->watch_pos > WATCH_COALESCE || change_read(s->watch_pos, &c) != 0) {
+            watch_coalesce(s, head);
+            continue;
+        }
+        s->watch_pos++;
+        if (s->watch_states & (1u << c.state))
+            watch_send(s, what[c.state], c.id, (int)c.state, c.tech_uid);
+    }
+    return 1;
+}
+
+/* -------------------
+ * Traitement des commandes
+ * ------------------- */
+
+// Lit le texte d'un ticket : "titre" "description" (tronqués à leur taille maximale)
+// Retourne NULL, sinon le message d'erreur
+static const char *parse_ticket_text(const char *p, ticket_draft_t *d) {
+    const char *q = strchr(p, '"');
+    if (!q) return "Guillemet d'ouverture manquante pour le titre\n";
+    q++;
+    const char *e = strchr(q, '"');
+    if (!e) return "Guillemet de fermeture manquante pour le titre\n";
+    size_t l = (size_t)(e - q);
+    if (l >= sizeof(d->title)) l = sizeof(d->title) - 1;
+    memcpy(d->title, q, l);
+    d->title[l] = '\0';
+
+    const char *q2 = strchr(e + 1, '"');
+    if (!q2) return "Guillemet d'ouverture manquante pour la description\n";
+    q2++;
+    const char *e2 = strchr(q2, '"');
+    if (!e2) return "Guillemet de fermeture manquante pour la description\n";
+    size_t l2 = (size_t)(e2 - q2);
+    if (l2 >= sizeof(d->desc)) l2 = sizeof(d->desc) - 1;
+    memcpy(d->desc, q2, l2);
+    d->desc[l2] = '\0';
+    return NULL;
+}
+
+// Crée les tickets d'un lot complet sous un seul index_lock, puis répond avec leurs ID
+static void session_batch_commit(session_t *s) {
+    ticket_batch_t *b = s->batch;
+    uint32_t *ids = malloc(sizeof(*ids) * (b->count + 1));
+    uint32_t created = 0;
+
+    if (ids) {
+        index_lock();
+        while (created < b->count &&
+               insert_ticket(s->uid, b->drafts[created].title, b->drafts[created].desc, &ids[created]) == 0)
+            created++;
+        if (created > 0 && g_cfg.dispatch_open) dispatch_run();
+        index_unlock();
+    }
+
+    if (created > 0) {
+        sendall(s, "Tickets créés avec ID");
+        for (uint32_t i = 0; i < created; i++) {
+            char num[16];
+            snprintf(num, sizeof(num), " %u", ids[i]);
+            sendall(s, num);
+        }
+        sendall(s, "\n");
+    }
+    if (b->errors) sendall(s, b->errors);
+    if (!ids) {
+        sendall(s, "Mémoire insuffisante pour le lot, réessayez plus tard.\n");
+    } else if (created < b->count) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Stockage des tickets plein : %u ticket(s) non créé(s).\n", b->count - created);
+        sendall(s, msg);
+    } else if (created == 0) {
+        sendall(s, "Aucun ticket créé.\n");
+    }
+
+    free(ids);
+    free(b->drafts);
+    free(b->errors);
+    free(b);
+    s->batch = NULL;
+    s->state = SESS_COMMAND;
+}
+
+// Ligne d'un lot : lue tout de suite (hors verrou), les tickets sont créés à la dernière
+// Compte une ligne du lot en cours, valide (err NULL, ticket déjà dans drafts) ou rejetée
+static void session_batch_add(session_t *s, const char *err) {
+    ticket_batch_t *b = s->batch;
+
+    b->received++;
+    if (!err) {
+        b->count++;
+    } else {
+        char line[160];
+        int n = snprintf(line, sizeof(line), "Ligne %u ignorée : %s", b->received, err);
+        char *grown = realloc(b->errors, b->errors_len + (size_t)n + 1);
+        if (grown) {
+            memcpy(grown + b->errors_len, line, (size_t)n + 1);
+            b->errors = grown;
+            b->errors_len += (size_t)n;
+        }
+    }
+    if (b->received == b->expected)
+        session_batch_commit(s);
+}
+
+static void session_batch_line(session_t *s, const char *buf) {
+    ticket_batch_t *b = s->batch;
+    session_batch_add(s, parse_ticket_text(buf, &b->drafts[b->count]));
+}
+
+// Lit les ID d'une commande take/close ("12 15 16") ; un ID répété n'est gardé qu'une fois
+// Retourne leur nombre, -1 si un mot n'est pas un ID (non numérique, négatif, au-delà de
+// UINT32_MAX) ou s'il y en a plus que max
+static int parse_ids(const char *p, uint32_t *ids, int max) {
+    int n = 0;
+
+    while (1) {
+        while (*p == ' ') p++;
+        if (*p == '\0') return n;
+        char word[24];
+        size_t len = strcspn(p, " ");
+        uint32_t id;
+        if (len >= sizeof(word)) return -1;
+        memcpy(word, p, len);
+        word[len] = '\0';
+        if (parse_u32(word, &id) != 0) return -1;
+        p += len;
+
+        int seen = 0;
+        for (int i = 0; i < n && !seen; i++) seen = ids[i] == id;
+        if (seen) continue;
+        if (n == max) return -1;
+        ids[n++] = id;
+    }
+}
+
+// Prend le ticket id pour le technicien uid ; retourne la réponse
+// Appelant : index_lock verrouillé
+static const char *tech_take(uint32_t uid, uint32_t id) {
+    int64_t slot = find_ticket_by_id(id, NULL);
+    if (slot == -1) return "Ticket introuvable.\n";
+    if (slot < 0 || ticket_at((uint32_t)slot)->state == CLOSED) return "Ticket déjà clos.\n";
+    if (count_assigned_to_technician(uid) >= (int)tech_capacity(user_at(uid))) return "Capacité maximale atteinte (voir capacity).\n";
+    if (ticket_assign((uint32_t)slot, uid) != 0) return "Ticket déjà clos.\n";
+    return "Ticket pris en charge.\n";
+}
+
+// Clôture le ticket id s'il est assigné au technicien uid ; retourne la réponse
+// Appelant : index_lock verrouillé
+static const char *tech_close(uint32_t uid, uint32_t id) {
+    int64_t slot = find_ticket_by_id(id, NULL);
+    if (slot == -1) return "Ticket introuvable.\n";
+    if (slot < 0) return "Ticket déjà clos.\n";
+
+    const char *msg = "Ticket clôturé.\n";
+    ticket_hot_t *t = ticket_at((uint32_t)slot);
+    ticket_write_begin((uint32_t)slot);
+    if (t->state == CLOSED) msg = "Ticket déjà clos.\n";
+    else if (t->tech_uid != uid + 1) msg = "Vous n'êtes pas assigné à ce ticket.\n";
+    else ticket_close((uint32_t)slot);
+    ticket_write_end((uint32_t)slot);
+    return msg;
+}
+
+// Traite une commande du client (hors questionnaire de sortie)
+static void handle_command(session_t *s, char *buf) {
+    char *username = s->username;
+
+    // --- Commande IDENT ---
+    if (strncmp(buf, "IDENT ", 6) == 0) {
+        char name[MAX_USER], role[32] = "";
+        if (sscanf(buf+6, "%63s %31s", name, role) >= 1) {
+            // Le nom est remplacé par son uid pour toutes les commandes suivantes ; si
+            // l'annuaire est plein, la session garde son identité précédente
+            index_lock();
+            int64_t uid = user_intern(name);
+            index_unlock();
+            if (uid < 0) {
+                sendall(s, "Annuaire des utilisateurs plein, réessayez plus tard.\n");
+                return;
+            }
+            strcpy(username, name);
+            s->uid = (uint32_t)uid;
+            if (strcmp(role, "tech")==0)
+                s->is_technician = 1;
+            else
+                s->is_technician = 0;
+
+            char tmp[128];
+            snprintf(tmp, sizeof(tmp), "Identifié en tant que '%s' (role=%s)\n", username, s->is_technician?"TECH":"USER");
+            sendall(s, tmp);
+
+            // Un technicien devient candidat à la répartition, qui lui donne aussitôt sa part
+            // des tickets en attente (une nouvelle identification remplace la précédente)
+            index_lock();
+            if (s->online) tech_online_remove(s->online);
+            s->online = s->is_technician ? tech_online_add(s->uid) : 0;
+            uint32_t before = user_at(s->uid)->in_progress;
+            if (s->online) dispatch_run();
+            int assigned = (int)(user_at(s->uid)->in_progress - before);
+            index_unlock();
+            if (s->is_technician) {
+                if (assigned > 0) {
+                    char tmsg[128];
+                    snprintf(tmsg, sizeof(tmsg), "Assigné %d ticket(s) en attente à vous.\n", assigned);
+                    sendall(s, tmsg);
+                } else {
+                    sendall(s, "Aucun ticket en attente à vous assigner maintenant.\n");
+                }
+            }
+        } else {
+            sendall(s, "Usage IDENT <username> <role:user|tech>\n");
+        }
+        return;
+    }
 
-// Structure d’un ticket
-typedef struct {
-    uint32_t id;                    // ID unique du ticket
-    char title[MAX_TITLE];          // Titre
-    char desc[MAX_DESC];            // Description
-    char owner[MAX_USER];           // Utilisateur ayant créé le ticket
-    char technician[MAX_USER];      // Technicien assigné (ou vide)
-    ticket_state_t state;           // État du ticket
-    time_t created;                 // Date/heure de création
-} ticket_t;
+    // --- Commandes utilisateur ---
+    if (strncmp(buf, "sendTicket ", 11) == 0) {
+        if (username[0]==0) { sendall(s, "Identifiez-vous d'abord (IDENT ...)\n"); return; }
 
-// Structure d’un feedback utilisateur
-typedef struct {
-    char username[MAX_USER];
-    int note_reactivite;
-    int note_competence;
-    int note_satisfaction;
-} feedback_t;
+        // Création d’un ticket
+        if (strncmp(buf+11, "-new", 4) == 0) {
+            ticket_draft_t d;
 
-// --- Structure partagée entre processus ---
-typedef struct {
-    pthread_mutex_t mutex;          // Mutex partagé entre processus
-    int initialized;                // Indique si la mémoire est initialisée
-    ticket_t tickets[MAX_TICKETS];  // Tableau circulaire de tickets
-    int next_index;                 // Position d’insertion suivante
-    uint32_t next_id;               // Prochain ID de ticket
-    feedback_t feedbacks[MAX_FEEDBACK]; // Tableau circulaire de feedbacks
-    int next_feedback_index;        // Position d’insertion suivante pour feedbacks
-} shared_data_t;
+            // Extraction naïve entre guillemets
+            if (!strchr(buf+15, '"')) { sendall(s, "Usage: sendTicket -new \"title\" \"description\"\n"); return; }
+            const char *err = parse_ticket_text(buf+15, &d);
+            if (err) { sendall(s, err); return; }
 
-static shared_data_t *g_shm = NULL; // Pointeur global vers la mémoire partagée
+            index_lock();
+            uint32_t id;
+            int rc = insert_ticket(s->uid, d.title, d.desc, &id);
+            if (rc == 0 && g_cfg.dispatch_open) dispatch_run();
+            index_unlock();
 
-// --- Fonction utilitaire pour quitter avec message d’erreur ---
-static void perror_exit(const char *msg){
-    perror(msg);
-    exit(EXIT_FAILURE);
-}
+            if (rc != 0) { sendall(s, "Stockage des tickets plein, réessayez plus tard.\n"); return; }
+            char out[128];
+            snprintf(out, sizeof(out), "Ticket créé avec ID %u\n", id);
+            sendall(s, out);
+        }
+        // Lot de tickets : les N lignes suivantes sont chacune "titre" "description"
+        else if (strncmp(buf+11, "-batch", 6) == 0 && (buf[17] == '\0' || buf[17] == ' ')) {
+            char *end;
+            unsigned long n = strtoul(buf+17, &end, 10);
+            while (*end == ' ') end++;
+            if (n == 0 || n > BATCH_MAX || *end != '\0') {
+                char msg[128];
+                snprintf(msg, sizeof(msg), "Usage: sendTicket -batch N (1 à %d), puis N lignes \"title\" \"description\"\n", BATCH_MAX);
+                sendall(s, msg);
+                return;
+            }
+            ticket_batch_t *b = calloc(1, sizeof(*b));
+            if (b) b->drafts = malloc(sizeof(*b->drafts) * n);
+            if (!b || !b->drafts) {
+                free(b);
+                sendall(s, "Mémoire insuffisante pour le lot, réessayez plus tard.\n");
+                return;
+            }
+            b->expected = (uint32_t)n;
+            s->batch = b;
+            s->state = SESS_BATCH;
+        }
+        // Liste des tickets
+        else if (strncmp(buf+11, "-l", 2) == 0 && (buf[13] == '\0' || buf[13] == ' ')) {
+            uint32_t after, limit;
+            if (parse_list_args(buf+13, &after, &limit) != 0)
+                sendall(s, "Usage: sendTicket -l [--after <id>] [--limit N]\n");
+            else
+                session_start_listing(s, 0, 0, 0, after, limit, "");
+        } else {
+            sendall(s, "Usage: sendTicket -new \"title\" \"description\" OR sendTicket -batch N OR sendTicket -l [--after <id>] [--limit N]\n");
+        }
+        return;
+    }
+    // --- Commande EXIT ---
+    if (strcmp(buf, "exit") == 0) {
+        if (username[0] == 0) {
+            sendall(s, "Vous devez être identifié avant de quitter.\n");
+            return;
+        }
 
-// --- Initialisation de la mémoire partagée (si pas encore faite) ---
-static void shm_init_if_needed() {
-    // Si l'espace mémoire du mutex n'est pas dfinie
-    if (!g_shm) return;
+        if (!s->is_technician) {
+            // Le questionnaire se poursuit dans handle_feedback_answer
+            sendall(s, "Merci de donner votre avis avant de quitter.\n");
+            sendall(s, "Notez la réactivité du service (💩1-5🌟) : ");
+            s->state = SESS_NOTE_REACTIVITE;
+        } else {
+            sendall(s, "Déconnexion du technicien.\n");
+            s->state = SESS_CLOSING;
+        }
+        return;
+    }
 
-    // Lock le mutex
-    pthread_mutex_lock(&g_shm->mutex);
-    if (!g_shm->initialized) {
-        // Réinitialise tout le contenu
-        g_shm->next_index = 0;
-        g_shm->next_id = 1;
-        for (int i=0;i<MAX_TICKETS;i++){
-            g_shm->tickets[i].id = 0;
-            g_shm->tickets[i].state = CLOSED;
-            g_shm->tickets[i].created = 0;
-            g_shm->tickets[i].owner[0] = '\0';
-            g_shm->tickets[i].technician[0] = '\0';
-            g_shm->tickets[i].title[0]= '\0';
-            g_shm->tickets[i].desc[0]= '\0';
+
+    // --- Commandes technicien ---
+    if (s->is_technician) {
+        // Liste les tickets visibles
+        if (strncmp(buf, "list", 4) == 0 && (buf[4] == '\0' || buf[4] == ' ')) {
+            uint32_t states, after, limit;
+            time_t since;
+            char resume[128];
+            if (parse_tech_list_args(buf+4, &states, &since, &after, &limit, resume, sizeof(resume)) != 0)
+                sendall(s, "Usage: list [--state OPEN,PRIORITY,...] [--since <date>] [--after <id>] [--limit N]\n");
+            else
+                session_start_listing(s, 1, states, since, after, limit, resume);
+            return;
+        }
+
+        // Recherche dans les titres et descriptions
+        if (strncmp(buf, "search", 6) == 0 && (buf[6] == '\0' || buf[6] == ' ')) {
+            search_query_t q;
+            uint32_t states, after, limit;
+            char resume[MAX_LINE + 32];
+            if (parse_search_args(buf+6, &q, &states, &after, &limit, resume, sizeof(resume)) != 0)
+                sendall(s, "Usage: search [--state OPEN,PRIORITY,...] [--after <id>] [--limit N] mot [OR mot] ...\n");
+            else
+                session_start_search(s, &q, states, after, limit, resume);
+            return;
+        }
+
+        // Prendre ou fermer un ou plusieurs tickets : les ID sont lus avant de prendre
+        // index_lock, une seule fois pour tous (close change le ticket de liste d'état)
+        if (strncmp(buf, "take ", 5) == 0 || strncmp(buf, "close ", 6) == 0) {
+            int take = buf[0] == 't';
+            uint32_t ids[BATCH_MAX];
+            const char *msgs[BATCH_MAX];
+            int n = parse_ids(buf + (take ? 5 : 6), ids, BATCH_MAX);
+            if (n <= 0) {
+                char msg[96];
+                snprintf(msg, sizeof(msg), "Usage: %s <id> [<id> ...] (%d au plus)\n", take ? "take" : "close", BATCH_MAX);
+                sendall(s, msg);
+                return;
+            }
+            index_lock();
+            for (int i = 0; i < n; i++)
+                msgs[i] = take ? tech_take(s->uid, ids[i]) : tech_close(s->uid, ids[i]);
+            // Places libérées (clôture, ticket repris à un autre technicien) : répartition
+            dispatch_run();
+            index_unlock();
+
+            // Une réponse par ID, précédée de l'ID quand il y en a plusieurs
+            for (int i = 0; i < n; i++) {
+                if (n > 1) {
+                    char prefix[16];
+                    snprintf(prefix, sizeof(prefix), "%u : ", ids[i]);
+                    sendall(s, prefix);
+                }
+                sendall(s, msgs[i]);
+            }
+            return;
+        }
+        // Capacité du technicien : tickets IN_PROGRESS qu'il accepte de la répartition et de take
+        if (strncmp(buf, "capacity", 8) == 0 && (buf[8] == '\0' || buf[8] == ' ')) {
+            const char *arg = buf + 8 + strspn(buf+8, " ");
+            char *end = (char*)arg;
+            unsigned long cap = *arg ? strtoul(arg, &end, 10) : 0;
+            int set = *arg != '\0';
+            while (*end == ' ') end++;
+            if (*end != '\0' || (set && (cap == 0 || cap > TECH_CAPACITY_MAX))) {
+                char msg[96];
+                snprintf(msg, sizeof(msg), "Usage: capacity [N] (1 à %d)\n", TECH_CAPACITY_MAX);
+                sendall(s, msg);
+                return;
+            }
+            index_lock();
+            user_entry_t *u = user_at(s->uid);
+            if (set) {
+                u->capacity = (uint32_t)cap;
+                tech_update(s->uid);
+                dispatch_run();
+            }
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Capacité : %u ticket(s), %u en cours.\n", tech_capacity(u), u->in_progress);
+            index_unlock();
+            sendall(s, msg);
+            return;
+        }
+
+        // Abonnement aux changements des tickets (tous les états par défaut)
+        if (strncmp(buf, "watch", 5) == 0 && (buf[5] == '\0' || buf[5] == ' ')) {
+            uint32_t states = 0xF;
+            char opt[16], spec[64], extra;
+            int n = sscanf(buf+5, " %15s %63s %c", opt, spec, &extra);
+            if (n > 0 && (n != 2 || strcmp(opt, "--state") != 0 || parse_states(spec, &states) != 0)) {
+                sendall(s, "Usage: watch [--state OPEN,PRIORITY,...]\n");
+                return;
+            }
+            if (!t_watch) {
+                sendall(s, "watch n'est disponible qu'en mode epoll.\n");
+                return;
+            }
+            watch_start(s, states);
+            sendall(s, "Suivi des tickets (envoyez une ligne pour l'arrêter).\n");
+            return;
         }
-        g_shm->next_feedback_index = 0;
-        for (int i = 0; i < MAX_FEEDBACK; i++) {
-            g_shm->feedbacks[i].username[0] = '\0';
-            g_shm->feedbacks[i].note_reactivite = -1;
-            g_shm->feedbacks[i].note_competence = -1;
-            g_shm->feedbacks[i].note_satisfaction = -1;
-            g_shm->initialized = 1;
+        if (strcmp(buf, "showFeedback") == 0) {
+            uint32_t cap = g_shm->feedback_cap;
+            feedback_t *fb = malloc(sizeof(*fb) * cap);
+            uint32_t n = fb ? feedback_snapshot(fb, cap) : 0;
+            for (uint32_t i = 0; i < n; i++) {
+                char line[256];
+                feedback_t *f = &fb[i];
+                snprintf(line, sizeof(line),
+                    "Client: %s | Réactivité:%d | Compétence:%d | Satisfaction:%d\n",
+                    f->username, f->note_reactivite, f->note_competence, f->note_satisfaction);
+                sendall(s, line);
+            }
+            free(fb);
+            if (n == 0)
+                sendall(s, "Aucun avis enregistré.\n");
+            return;
+        }
+        if (strcmp(buf, "STATS") == 0) {
+            char *text = NULL;
+            size_t len = 0;
+            FILE *fp = open_memstream(&text, &len);
+            if (!fp) {
+                sendall(s, "Mémoire insuffisante pour les statistiques.\n");
+                return;
+            }
+            stats_report(fp);
+            fclose(fp);
+            sendall(s, text);
+            free(text);
+            return;
         }
     }
 
-    // Unlock le mutex
-    pthread_mutex_unlock(&g_shm->mutex);
+    // Délimitation des réponses pour les clients scriptés
+    if (strncmp(buf, "FRAMING ", 8) == 0) {
+        if (strcmp(buf+8, "on") == 0) s->framed = 1;
+        else if (strcmp(buf+8, "off") == 0) s->framed = 0;
+        else { sendall(s, "Usage: FRAMING on|off\n"); return; }
+        sendall(s, s->framed ? "Réponses délimitées.\n" : "Réponses non délimitées.\n");
+        return;
+    }
+
+    // Aide
+    if (strcmp(buf, "help") == 0) {
+        sendall(s,
+            "Commandes (une par ligne, plusieurs lignes peuvent être envoyées d'un coup):\n"
+            "IDENT <username> <role:user|tech>\n"
+            "sendTicket -new \"title\" \"description\"\n"
+            "sendTicket -batch N puis N lignes \"title\" \"description\" (tickets créés d'un coup)\n"
+            "sendTicket -l [--after <id>] [--limit N]\n"
+            "list [--after <id>] [--limit N] (technicien pour voir ses tickets)\n"
+            "list --state S,... [--since <date>] [--after <id>] [--limit N] (technicien : tous les tickets de ces états)\n"
+            "search [--state S,...] [--after <id>] [--limit N] mots (technicien, OR entre deux mots pour l'un ou l'autre)\n"
+            "take <id> [<id> ...] (technicien)\n"
+            "close <id> [<id> ...] (technicien)\n"
+            "capacity [N] (technicien : tickets en cours acceptés, répartition comprise)\n"
+            "watch [--state S,...] (technicien : changements des tickets en direct, une ligne pour arrêter)\n"
+            "showFeedback (technicien)\n"
+            "STATS (technicien : compteurs, latences, verrous, occupation)\n"
+            "FRAMING on|off (réponses terminées par une ligne \".\")\n"
+            "exit\n"
+        );
+        return;
+    }
+
+    sendall(s, "Commande inconnue. 'help' pour l'aide.\n");
 }
 
-// --- Création/attachement de la mémoire partagée ---
-static void shm_open_map() {
-    int fd;
-    size_t sz;
+// Traite une réponse au questionnaire de sortie (une note de 1 à 5)
+static void handle_feedback_answer(session_t *s, const char *buf) {
+    int note = atoi(buf);
 
-    //fd = shm_open(SHM_NAME, O_RDWR | O_CREAT, 0600); // Ouvre ou crée la mémoire partagée
-    fd = open("./shared_mem.dat", O_RDWR | O_CREAT, 0600);
-    if (fd < 0) 
-        perror_exit("Erreur lors de l'ouverture de la mémoire partagée");
+    switch (s->state) {
+        case SESS_NOTE_REACTIVITE:
+            if (note == 0) { sendall(s, "Notez la réactivité du service (💩1-5🌟) : "); return; }
+            s->notes[0] = note;
+            sendall(s, "Notez la compétence du technicien (💩1-5🌟) : ");
+            s->state = SESS_NOTE_COMPETENCE;
+            return;
+        case SESS_NOTE_COMPETENCE:
+            if (note == 0) { sendall(s, "Notez la compétence du technicien (💩1-5🌟) : "); return; }
+            s->notes[1] = note;
+            sendall(s, "Notez votre satisfaction globale (💩1-5🌟) : ");
+            s->state = SESS_NOTE_SATISFACTION;
+            return;
+        case SESS_NOTE_SATISFACTION:
+            if (note == 0) { sendall(s, "Notez votre satisfaction globale (💩1-5🌟) : "); return; }
+            s->notes[2] = note;
 
-    sz = sizeof(shared_data_t);
-    if (ftruncate(fd, sz) == -1) perror_exit("Erreur lors du troncage de la mémoire partagée"); // Définit la taille du segment
+            add_feedback(s->username, s->notes[0], s->notes[1], s->notes[2]);
 
-    void *addr = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); // Mappe dans l’espace mémoire
-    if (addr == MAP_FAILED) 
-        perror_exit("Erreur lors du mappage");
+            sendall(s, "Merci pour votre retour ! Au revoir.\n");
+            s->state = SESS_CLOSING;
+            return;
+        default:
+            return;
+    }
+}
 
-    g_shm = (shared_data_t*)addr;
+// Termine une réponse délimitée (mode FRAMING on) par une ligne "."
+static void session_end_frame(session_t *s) {
+    s->stuffing = 0;
+    if (!s->out_bol) sendall(s, "\n"); // Invite sans retour à la ligne (questionnaire)
+    sendall(s, ".\n");
+}
 
-    // --- Initialisation du mutex partagé entre processus ---
-    static int tried_init = 0;
-    if (!tried_init) {
-        tried_init = 1;
-
-        // Vérifie si le mutex semble vierge (non initialisé)
-        int is_mutex_empty = 1;
-        for (size_t i = 0; i < sizeof(pthread_mutex_t) ;i++){
-            char *p = ((char*)&g_shm->mutex) + i;
-            if (*p != 0) { 
-                is_mutex_empty = 0; 
-                break; 
-            }
+// Fin du listing en cours : la réponse est complète
+static void session_end_listing(session_t *s) {
+    list_cursor_close(s->cursor);
+    free(s->cursor);
+    s->cursor = NULL;
+    if (s->framed)
+        session_end_frame(s);
+}
+
+// Type d'une commande pour les statistiques (mêmes préfixes que handle_command)
+static cmd_kind_t cmd_classify(const char *buf) {
+    if (strncmp(buf, "IDENT ", 6) == 0) return CMD_IDENT;
+    if (strncmp(buf, "sendTicket ", 11) == 0)
+        return strncmp(buf+11, "-new", 4) == 0 ? CMD_NEW : strncmp(buf+11, "-batch", 6) == 0 ? CMD_BATCH : CMD_MYLIST;
+    if (strncmp(buf, "list", 4) == 0 && (buf[4] == '\0' || buf[4] == ' ')) return CMD_LIST;
+    if (strncmp(buf, "search", 6) == 0 && (buf[6] == '\0' || buf[6] == ' ')) return CMD_SEARCH;
+    if (strncmp(buf, "take ", 5) == 0) return CMD_TAKE;
+    if (strncmp(buf, "close ", 6) == 0) return CMD_CLOSE;
+    if (strcmp(buf, "showFeedback") == 0) return CMD_FEEDBACK;
+    if (strncmp(buf, "capacity", 8) == 0 && (buf[8] == '\0' || buf[8] == ' ')) return CMD_CAPACITY;
+    if (strncmp(buf, "watch", 5) == 0 && (buf[5] == '\0' || buf[5] == ' ')) return CMD_WATCH;
+    if (strcmp(buf, "STATS") == 0) return CMD_STATS;
+    if (strncmp(buf, "FRAMING ", 8) == 0) return CMD_FRAMING;
+    if (strcmp(buf, "help") == 0) return CMD_HELP;
+    if (strcmp(buf, "exit") == 0) return CMD_EXIT;
+    return CMD_OTHER;
+}
+
+// Traite un message reçu du client selon l'état de la session
+static void session_on_message(session_t *s, char *buf) {
+    // Supprime les \n finaux
+    char *p = buf + strlen(buf)-1;
+    while (p >= buf && (*p == '\n' || *p == '\r')) { *p = '\0'; p--; }
+
+    // Pendant un suivi, toute ligne y met fin (sans être exécutée) et termine sa réponse
+    if (s->watching) {
+        watch_stop(s);
+        sendall(s, "Fin du suivi.\n");
+        if (s->framed) session_end_frame(s);
+        s->stuffing = 0;
+        return;
+    }
+
+    s->stuffing = s->framed;
+    s->out_bol = 1;
+    uint64_t t0 = t_stats ? now_ns() : 0;
+    if (s->state == SESS_COMMAND) {
+        cmd_kind_t kind = cmd_classify(buf);
+        handle_command(s, buf);
+        // Un lot est compté une fois, quand sa dernière ligne crée les tickets
+        if (s->state != SESS_BATCH) stat_command(kind, t0 ? now_ns() - t0 : 0);
+    } else if (s->state == SESS_BATCH) {
+        session_batch_line(s, buf);
+        if (s->state != SESS_BATCH) stat_command(CMD_BATCH, t0 ? now_ns() - t0 : 0);
+    } else if (s->state != SESS_CLOSING) {
+        handle_feedback_answer(s, buf);
+        stat_command(CMD_NOTE, t0 ? now_ns() - t0 : 0);
+    }
+
+    // Un listing se termine plus tard, dans session_end_listing ; un suivi, à la ligne
+    // suivante du client ; un lot, avec sa dernière ligne
+    if (s->cursor || s->watching) return;
+    if (s->framed && s->state != SESS_BATCH)
+        session_end_frame(s);
+    s->stuffing = 0;
+}
+
+// Ligne trop longue, rejetée sans être exécutée : elle met fin au suivi en cours, compte
+// comme une ligne rejetée du lot en cours, et sinon reçoit sa propre réponse (délimitée
+// en mode FRAMING on, comme celle d'une commande)
+static void session_on_long_line(session_t *s) {
+    char msg[64];
+
+    if (s->watching) {
+        char none[1] = "";
+        session_on_message(s, none);
+        return;
+    }
+    s->stuffing = s->framed;
+    s->out_bol = 1;
+    if (s->state == SESS_BATCH) {
+        snprintf(msg, sizeof(msg), "Texte trop long (max %d octets)\n", MAX_LINE - 1);
+        session_batch_add(s, msg);
+    } else {
+        snprintf(msg, sizeof(msg), "Ligne trop longue (max %d octets).\n", MAX_LINE - 1);
+        sendall(s, msg);
+    }
+    if (s->framed && s->state != SESS_BATCH)
+        session_end_frame(s);
+    s->stuffing = 0;
+}
+
+// Exécute les lignes complètes reçues ; la fin de ligne partielle est gardée pour le
+// prochain recv. S'arrête sur un listing ou quand la sortie dépasse OUT_HIGH_WATER :
+// les commandes suivantes attendent que le client ait lu les réponses.
+// Retourne le nombre de lignes consommées
+static int session_on_input(session_t *s) {
+    size_t start = 0;
+    int lines = 0;
+    char *nl = NULL;
+
+    while (s->state != SESS_CLOSING && !s->cursor && s->out_queued < OUT_HIGH_WATER) {
+        nl = memchr(s->in + start, '\n', s->inlen - start);
+        if (!nl) break;
+        *nl = '\0';
+        if (s->discarding)
+            s->discarding = 0;
+        else
+            session_on_message(s, s->in + start);
+        start = (size_t)(nl - s->in) + 1;
+        lines++;
+    }
+
+    // Les commandes envoyées après exit sont ignorées
+    if (s->state == SESS_CLOSING) { s->inlen = 0; return lines; }
+
+    memmove(s->in, s->in + start, s->inlen - start);
+    s->inlen -= start;
+
+    // Tampon plein sans fin de ligne : la ligne est rejetée jusqu'au prochain \n
+    if (!nl && s->inlen == sizeof(s->in)) {
+        if (!s->discarding) session_on_long_line(s);
+        s->discarding = 1;
+        s->inlen = 0;
+        lines++;
+    }
+    return lines;
+}
+
+// Fin du flux du client : une dernière commande sans \n est exécutée, puis la session se termine
+static void session_on_eof(session_t *s) {
+    if (s->inlen > 0 && !s->discarding && s->state != SESS_CLOSING) {
+        s->in[s->inlen < sizeof(s->in) ? s->inlen : sizeof(s->in) - 1] = '\0';
+        session_on_message(s, s->in);
+    }
+    s->inlen = 0;
+    s->state = SESS_CLOSING;
+}
+
+// Fait avancer la session : suite du listing en cours, envoi des réponses, puis lecture
+// et exécution des commandes suivantes. Tant que la sortie n'est pas envoyée, le client
+// n'est plus lu (contre-pression) : la mémoire d'une session reste bornée.
+// Retourne -1 si la session est terminée, 0 si elle attend le socket (mode non bloquant)
+static int session_pump(session_t *s) {
+    char chunk[OUT_CHUNK];
+
+    for (;;) {
+        // Suite du listing en cours, dans la limite de la sortie en attente
+        while (s->cursor && s->out_queued < OUT_HIGH_WATER) {
+            size_t n = list_cursor_fill(s->cursor, chunk, sizeof(chunk));
+            session_append(s, chunk, n);
+            if (s->cursor->finished) session_end_listing(s);
         }
-        if (is_mutex_empty == 1) {
-            // Création du mutex partagé
-            pthread_mutexattr_t mattr;
+        // Changements suivis, dans la limite de la file de l'abonné
+        int watch_more = s->watching ? watch_fill(s) : 0;
 
-            // Initialisation des attributs du mutex
-            if (pthread_mutexattr_init(&mattr) != 0) 
-                perror_exit("Erreur lors de l'initialisation des attributs du mutex");
-            
-            // Attribut du mutex partagé entre les thread
-            if (pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED) != 0) 
-                perror_exit("Erreur lors de l'attribution de l'espace partagé");
+        // Les modifications faites par ces commandes sont sur disque avant la réponse
+        wal_sync(t_wal_lsn);
+        int rc = session_flush(s);
+        if (rc < 0) return -1;
+        if (rc > 0) return 0; // Attente de EPOLLOUT
+        if (s->cursor || watch_more) continue;
+        if (s->state == SESS_CLOSING) return -1; // Dernière réponse partie
 
-            // Initialisation du mutex global avec les attributs
-            if (pthread_mutex_init(&g_shm->mutex, &mattr) != 0) 
-                perror_exit("Erreur lors de l'initialisation du mutex global");
-            
-            pthread_mutexattr_destroy(&mattr);
-            g_shm->initialized = 0; // Marque non initialisé au niveau applicatif
+        // Commandes déjà reçues, sinon suite du flux
+        if (session_on_input(s) > 0) continue;
+
+        ssize_t n = recv(s->sock, s->in + s->inlen, sizeof(s->in) - s->inlen, 0);
+        if (n > 0) {
+            if (t_stats) stat_add(&t_stats->bytes_in, (uint64_t)n);
+            s->inlen += (size_t)n;
+            continue;
+        }
+        if (n == 0) {
+            session_on_eof(s); // Déconnexion : les réponses déjà prêtes partent quand même
+            continue;
         }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
     }
-    shm_init_if_needed(); // Termine l’initialisation logique
 }
 
 /* -------------------
- * Fonctions de gestion des tickets
+ * Mode threads : un thread bloquant par client (mode historique)
  * ------------------- */
 
-// Ajoute un nouveau ticket
-// Paramètres : 
-// owner = le nom d'utilisateur créant le ticket
-// title = le titre du ticket
-// desc = la description du ticket
-// out_id = pointeur vers l'adresse qui sera l'id du ticket créé
-static int insert_ticket(const char *owner, const char *title, const char *desc, uint32_t *out_id) {
-    
-    // Récupère l'addrese du nouveau ticket
-    ticket_t *t = &g_shm->tickets[g_shm->next_index];
+// Fonction principale exécutée par chaque thread client
+static void *client_thread(void *arg) {
+    session_t *s = arg;
 
-    // On remplit les infos du ticket
-    t->id = g_shm->next_id++;
-    strncpy(t->owner, owner, MAX_USER-1);
-    strncpy(t->title, title, MAX_TITLE-1);
-    strncpy(t->desc, desc, MAX_DESC-1);
-    t->state = OPEN;
-    t->technician[0] = '\0';
-    t->created = time(NULL);
+    stats_attach();
+    // Socket bloquant : session_pump ne rend la main qu'à la fin de la session
+    session_pump(s);
 
-    // Id du ticket créé
-    *out_id = t->id;
+    close(s->sock); // Ferme la connexion client
+    session_free(s);
+    list_cache_free();
+    audit_detach();
+    stats_detach();
+    return NULL;
+}
 
-    // Index circulaire
-    g_shm->next_index = (g_shm->next_index + 1) % MAX_TICKETS;
+/* -------------------
+ * Mode epoll : un accepteur + un pool de workers, chacun avec sa propre instance epoll
+ * ------------------- */
 
-    return 0;
-}
+typedef struct {
+    int epfd;                       // Instance epoll du worker
+    int cpu;                        // Coeur sur lequel le worker est épinglé (-1 = aucun)
+    pthread_t tid;
+    watch_list_t watch;             // Sessions abonnées aux changements (watch)
+} reactor_t;
 
-// Ajoute un feedback utilisateur
-static void add_feedback(const char *username, int n1, int n2, int n3) {
-    int idx = g_shm->next_feedback_index % MAX_FEEDBACK;
-    feedback_t *f = &g_shm->feedbacks[idx];
+static reactor_t g_reactors[MAX_WORKERS];
+static int g_nreactors = 0;
 
-    strncpy(f->username, username, MAX_USER-1);
-    f->note_reactivite = n1;
-    f->note_competence = n2;
-    f->note_satisfaction = n3;
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
 
-    g_shm->next_feedback_index++;
+static void reactor_close_session(reactor_t *r, session_t *s) {
+    epoll_ctl(r->epfd, EPOLL_CTL_DEL, s->sock, NULL);
+    close(s->sock);
+    session_free(s);
 }
 
+// Boucle d'un worker : chaque connexion appartient à un seul worker, sans verrou sur la session
+static void *reactor_thread(void *arg) {
+    reactor_t *r = arg;
+    struct epoll_event events[MAX_EVENTS];
 
-// Liste les tickets appartenant à un utilisateur
-static void list_tickets_for_owner(const char *owner, char *out, size_t outlen) {
-    char buf[1024];
-    buf[0] = '\0';
-    int found = 0;
+    stats_attach();
+    t_watch = &r->watch;
+    if (r->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(r->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            fprintf(stderr, "Impossible d'épingler le worker sur le coeur %d\n", r->cpu);
+    }
+
+    while (1) {
+        int n = epoll_wait(r->epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Erreur epoll_wait");
+            break;
+        }
+        int changes = 0;
+        for (int i = 0; i < n; i++) {
+            session_t *s = events[i].data.ptr;
+            uint32_t ev = events[i].events;
+            // eventfd du thread de suivi : traité après les sessions, qu'il peut fermer
+            if (!s) { changes = 1; continue; }
+            // Lit tout ce qui est disponible (edge-triggered) et envoie les réponses,
+            // jusqu'à ce que le socket soit vide en lecture ou plein en écriture
+            int rc = (ev & EPOLLERR) ? -1 : session_pump(s);
+            if (rc == 0 && (ev & EPOLLHUP))
+                rc = -1;
+            if (rc < 0)
+                reactor_close_session(r, s);
+        }
 
-    // On parcourt tout les tickets
-    for (int i=0;i<MAX_TICKETS;i++){
-        ticket_t *t = &g_shm->tickets[i];
+        // Changements publiés : chaque abonné du worker reçoit sa suite
+        if (changes) {
+            uint64_t v;
+            if (read(r->watch.evfd, &v, sizeof(v)) < 0 && errno != EAGAIN)
+                perror("Erreur de lecture de l'eventfd");
+            for (session_t *s = r->watch.head, *next; s; s = next) {
+                next = s->watch_next;
+                if (session_pump(s) < 0) reactor_close_session(r, s);
+            }
+        }
+    }
+    return NULL;
+}
 
-        // Si le propriétaire du ticket est le propriétaire demandé
-        if (t->id != 0 && strcmp(t->owner, owner) == 0) {
-            // On a trouvé au moins 1 ticket
-            found = 1;
+// Thread de suivi du processus : attend les changements publiés (futex partagé par tous
+// les processus) et réveille les workers qui ont des abonnés
+static void *watch_thread(void *arg) {
+    uint64_t seen = __atomic_load_n(&g_shm->change_head, __ATOMIC_ACQUIRE);
+    (void)arg;
 
-            // On remplis le buffer de réponse
-            char st[16];
-            switch(t->state){
-                case OPEN: strcpy(st,"OPEN"); break;
-                case IN_PROGRESS: strcpy(st,"IN_PROGRESS"); break;
-                case CLOSED: strcpy(st,"CLOSED"); break;
-                case PRIORITY: strcpy(st,"PRIORITY"); break;
+    while (1) {
+        uint32_t wake = __atomic_load_n(&g_shm->change_wake, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&g_shm->change_head, __ATOMIC_ACQUIRE);
+        if (head != seen) {
+            seen = head;
+            for (int i = 0; i < g_nreactors; i++) {
+                reactor_t *r = &g_reactors[i];
+                if (__atomic_load_n(&r->watch.count, __ATOMIC_RELAXED) && eventfd_write(r->watch.evfd, 1) != 0)
+                    perror("Erreur d'écriture de l'eventfd");
             }
-            // Formatte la date
-            char timebuf[64];
-            struct tm tm;
-            localtime_r(&t->created, &tm);
-            strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", &tm);
-            snprintf(buf+strlen(buf), sizeof(buf)-strlen(buf),
-                "ID:%u | %s | %s | tech:%s | created:%s\nTitle: %s\nDesc: %s\n\n",
-                t->id, st, t->owner, (t->technician[0] ? t->technician : "-"), timebuf, t->title, t->desc);
         }
+        futex_wait_ms(&g_shm->change_wake, wake, WATCH_CHECK_MS);
     }
-    
-    // Remplissage de la réponse
-    if (!found)
-        snprintf(out, outlen, "Aucun ticket pour %s\n", owner);
-    else 
-        strncpy(out, buf, outlen-1);
+    return NULL;
+}
+
+// Démarre le pool de workers, épinglés sur les coeurs autorisés pour le processus
+static void reactors_start(void) {
+    cpu_set_t allowed;
+    int cpus[CPU_SETSIZE];
+    int ncpus = 0;
+
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &allowed)) cpus[ncpus++] = c;
+    }
+    if (ncpus == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int c = 0; c < n && c < CPU_SETSIZE; c++) cpus[ncpus++] = c;
+    }
+
+    g_nreactors = g_cfg.workers > 0 ? g_cfg.workers : (ncpus > 0 ? ncpus : 1);
+    if (g_nreactors > MAX_WORKERS) g_nreactors = MAX_WORKERS;
+
+    for (int i = 0; i < g_nreactors; i++) {
+        reactor_t *r = &g_reactors[i];
+        r->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (r->epfd < 0) perror_exit("Erreur epoll_create1");
+        r->cpu = (g_cfg.pin_workers && ncpus > 0) ? cpus[i % ncpus] : -1;
+        r->watch.evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (r->watch.evfd < 0) perror_exit("Erreur eventfd");
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = NULL;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->watch.evfd, &ev) == -1)
+            perror_exit("Erreur epoll_ctl");
+        if (pthread_create(&r->tid, NULL, reactor_thread, r) != 0)
+            perror_exit("Erreur lors de la création d'un worker");
+        pthread_detach(r->tid);
+    }
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, watch_thread, NULL) != 0)
+        perror_exit("Erreur lors de la création du thread de suivi");
+    pthread_detach(tid);
 }
 
-// Compte les tickets pris par un technicien
-static int count_assigned_to_technician(const char *tech) {
-    int c=0;
-    for (int i=0;i<MAX_TICKETS;i++){
+// Confie une nouvelle connexion à un worker (répartition circulaire)
+static void reactors_dispatch(session_t *s) {
+    static unsigned next = 0;
+    reactor_t *r = &g_reactors[next++ % (unsigned)g_nreactors];
 
-        ticket_t *t = &g_shm->tickets[i];
+    // Le message d'accueil part avant l'enregistrement : la session n'est pas encore partagée
+    if (set_nonblocking(s->sock) == -1 || session_flush(s) < 0) {
+        close(s->sock);
+        session_free(s);
+        return;
+    }
 
-        // Si le tech du ticket est le tech demandé
-        if (t->id!=0 && strcmp(t->technician, tech)==0 && t->state==IN_PROGRESS)
-            c++;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = s;
+    if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, s->sock, &ev) == -1) {
+        perror("Erreur epoll_ctl");
+        close(s->sock);
+        session_free(s);
     }
-    return c;
 }
 
-// Assigne les tickets prioritaires à un technicien libre
-static int assign_priority_tickets_to(const char *tech) {
-    int assigned = 0;
-    int capacity = 5 - count_assigned_to_technician(tech);
+/* -------------------
+ * Bancs d'essai (--bench NOM), sur un fichier mappé séparé
+ * ------------------- */
 
-    // Si le technicien a moins de 5 tickets assignés
-    if (capacity <= 0) return 0;
-    
-    // Il faut que le technicien aie moins de 5 tickets
-    for (int i=0;i<MAX_TICKETS && capacity>0;i++){
+typedef struct {
+    int index;
+    int writer;
+    volatile int *stop;
+    uint64_t ops;
+    uint64_t read_ns;               // Durée cumulée des listings (lecteurs)
+} bench_worker_t;
 
-        ticket_t *t = &g_shm->tickets[i];
+// Remplit le stockage de test : BENCH_OWNERS utilisateurs de BENCH_TICKETS_PER_OWNER tickets
+static void bench_populate(void) {
+    char owner[MAX_USER];
+    uint32_t id;
 
-        // Si le ticket est prioritaire
-        if (t->id!=0 && t->state==PRIORITY) {
-            strncpy(t->technician, tech, MAX_USER-1);
-            t->state = IN_PROGRESS;
-            assigned++;
-            capacity--;
+    index_lock();
+    for (int t = 0; t < BENCH_TICKETS_PER_OWNER; t++) {
+        for (int o = 0; o < BENCH_OWNERS; o++) {
+            snprintf(owner, sizeof(owner), "bench-owner-%d", o);
+            int64_t uid = user_intern(owner);
+            if (uid < 0 || insert_ticket((uint32_t)uid, "Ticket de test", "Description du ticket de test", &id) != 0)
+                perror_exit("Erreur lors du remplissage du banc d'essai");
         }
     }
-    return assigned;
+    index_unlock();
 }
 
-// Met à jour les tickets vieux de 24h en PRIORITY
-static void update_priority_flags() {
-    time_t now = time(NULL);
-    for (int i=0;i<MAX_TICKETS;i++){
-        ticket_t *t = &g_shm->tickets[i];
-        if (t->id != 0 && t->state == OPEN) {
-            // Si le ticket a été créé il y a + de PRIORITY_SECNDS secondes (24 * 3600), il est prioritaire
-            if (difftime(now, t->created) >= PRIORITY_SECONDS) {
-                t->state = PRIORITY;
+// Lecteurs : listings propriétaire et technicien ; écrivains : take (réassignation)
+static void *bench_locks_thread(void *arg) {
+    bench_worker_t *w = arg;
+    char out[OUT_CHUNK];
+    char name[MAX_USER];
+    list_cursor_t cur;
+    unsigned seed = (unsigned)w->index * 7919u + 1;
+
+    while (!*w->stop) {
+        if (w->writer) {
+            uint32_t id = 1 + (uint32_t)rand_r(&seed) % (BENCH_OWNERS * BENCH_TICKETS_PER_OWNER);
+            snprintf(name, sizeof(name), "bench-tech-%d-%d", w->index, (int)(w->ops & 1));
+            index_lock();
+            int64_t slot = id_index_find(id);
+            int64_t uid = user_intern(name);
+            if (slot >= 0 && uid >= 0) ticket_assign((uint32_t)slot, (uint32_t)uid);
+            index_unlock();
+        } else {
+            int rc = -1;
+            uint64_t t0 = now_ns();
+            if (w->ops % 4 == 3) {
+                int64_t uid = user_find("bench-tech-0-0");
+                if (uid >= 0) rc = list_cursor_open_technician(&cur, (uint32_t)uid, 0, 0, 0, "");
+            } else {
+                snprintf(name, sizeof(name), "bench-owner-%d", rand_r(&seed) % BENCH_OWNERS);
+                int64_t uid = user_find(name);
+                if (uid >= 0) rc = list_cursor_open_owner(&cur, (uint32_t)uid, 0, 0);
             }
+            while (rc == 0 && !cur.finished)
+                list_cursor_fill(&cur, out, sizeof(out));
+            list_cursor_close(&cur);
+            w->read_ns += now_ns() - t0;
         }
+        w->ops++;
     }
+    list_cache_free();
+    return NULL;
 }
 
-// Recherche d’un ticket par ID
-static ticket_t* find_ticket_by_id(uint32_t id) {
-    for (int i=0;i<MAX_TICKETS;i++){
-        if (g_shm->tickets[i].id == id) return &g_shm->tickets[i];
+// Une mesure : readers lecteurs et BENCH_WRITERS écrivains pendant BENCH_SECONDS ;
+// *read_us reçoit la durée moyenne d'un listing (µs)
+static void bench_locks_phase(int readers, double *read_rate, double *write_rate, double *read_us) {
+    volatile int stop = 0;
+    int n = readers + BENCH_WRITERS;
+    bench_worker_t *w = calloc((size_t)n, sizeof(*w));
+    pthread_t *tids = calloc((size_t)n, sizeof(*tids));
+    if (!w || !tids) perror_exit("Erreur d'allocation du banc d'essai");
+
+    for (int i = 0; i < n; i++) {
+        w[i].index = i;
+        w[i].writer = i >= readers;
+        w[i].stop = &stop;
+        if (pthread_create(&tids[i], NULL, bench_locks_thread, &w[i]) != 0)
+            perror_exit("Erreur lors de la création d'un thread de banc d'essai");
     }
-    return NULL;
+    sleep(BENCH_SECONDS);
+    stop = 1;
+
+    uint64_t reads = 0, writes = 0, read_ns = 0;
+    for (int i = 0; i < n; i++) {
+        pthread_join(tids[i], NULL);
+        if (w[i].writer) writes += w[i].ops;
+        else reads += w[i].ops;
+        read_ns += w[i].read_ns;
+    }
+    *read_rate = (double)reads / BENCH_SECONDS;
+    *write_rate = (double)writes / BENCH_SECONDS;
+    *read_us = reads ? read_ns / 1e3 / (double)reads : 0.0;
+    free(w);
+    free(tids);
 }
 
-/* -------------------
- * Gestion des clients (threads)
- * ------------------- */
+// Banc "locks" : débit des listings et des take, verrou global contre verrous fins + seqlocks
+static void bench_locks(void) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int readers = g_cfg.workers > 0 ? g_cfg.workers : (ncpu > 2 ? (int)ncpu : 2);
+    double r[2], w[2], us[2];
 
-// Envoi du message s au client sock
-static void sendall(int sock, const char *s) {
-    size_t len = strlen(s);
+    bench_populate();
+    printf("Banc 'locks' : %d lecteur(s), %d écrivain(s), %d s par mode, %u tickets\n",
+        readers, BENCH_WRITERS, BENCH_SECONDS, g_shm->live_tickets);
 
-    send(sock, s, len, 0);
+    g_cfg.global_lock = 1;
+    bench_locks_phase(readers, &r[0], &w[0], &us[0]);
+    g_cfg.global_lock = 0;
+    bench_locks_phase(readers, &r[1], &w[1], &us[1]);
+
+    printf("  verrou global          : %12.0f listings/s %12.0f take/s\n", r[0], w[0]);
+    printf("  verrous fins + seqlock : %12.0f listings/s %12.0f take/s\n", r[1], w[1]);
+    printf("  gain                   : %11.2fx %22.2fx\n",
+        r[0] > 0 ? r[1] / r[0] : 0.0, w[0] > 0 ? w[1] / w[0] : 0.0);
 }
 
-// Fonction principale exécutée par chaque thread client
-static void *client_thread(void *arg) {
-    client_thread_arg_t *cta = arg;
-    int sock = cta->sock;
-    free(cta);
+// Banc "list" : durée des listings avec et sans le cache des tickets mis en forme, pendant
+// que les écrivains réassignent des tickets (chaque take invalide la version gardée)
+static void bench_list(void) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int readers = g_cfg.workers > 0 ? g_cfg.workers : (ncpu > 2 ? (int)ncpu : 2);
+    double r[2], w[2], us[2];
 
-    char buf[BUFSIZE];
-    char username[MAX_USER] = {0};
-    int is_technician = 0;
+    bench_populate();
+    printf("Banc 'list' : %d lecteur(s), %d écrivain(s), %d s par mode, %u tickets\n",
+        readers, BENCH_WRITERS, BENCH_SECONDS, g_shm->live_tickets);
 
-    // Message d’accueil
-    sendall(sock, "Bienvenue sur le serveur de ticketing. \nUsage: IDENT <username> <role:user|tech>\n");
+    g_cfg.list_cache = 0;
+    bench_locks_phase(readers, &r[0], &w[0], &us[0]);
+    g_cfg.list_cache = 1;
+    bench_locks_phase(readers, &r[1], &w[1], &us[1]);
 
-    // Boucle d'écoute du client
-    while (1) {
+    printf("  sans cache : %12.0f listings/s, %8.1f µs par listing %12.0f take/s\n", r[0], us[0], w[0]);
+    printf("  avec cache : %12.0f listings/s, %8.1f µs par listing %12.0f take/s\n", r[1], us[1], w[1]);
+    printf("  gain       : %11.2fx %22.2fx\n", r[0] > 0 ? r[1] / r[0] : 0.0, us[1] > 0 ? us[0] / us[1] : 0.0);
+}
 
-        // En attente d'une commande du client
-        ssize_t mess = recv(sock, buf, sizeof(buf)-1, 0);
-        if (mess <= 0) break; // Déconnexion
-        buf[mess] = '\0';
-
-        // Supprime les \n finaux
-        char *p = buf + strlen(buf)-1;
-        while (p >= buf && (*p == '\n' || *p == '\r')) { *p = '\0'; p--; }
-        //printf("%s\n",buf);
-
-        // --- Commande IDENT ---
-        if (strncmp(buf, "IDENT ", 6) == 0) {
-            char role[32];
-            if (sscanf(buf+6, "%63s %31s", username, role) >= 1) {
-                if (strcmp(role, "tech")==0)
-                    is_technician = 1;
-                else
-                    is_technician = 0;
-
-                char tmp[128];
-                snprintf(tmp, sizeof(tmp), "Identifié en tant que '%s' (role=%s)\n", username, is_technician?"TECH":"USER");
-                sendall(sock, tmp);
-
-                // Si technicien → assigne tickets prioritaires
-                if (is_technician) {
-                    pthread_mutex_lock(&g_shm->mutex);
-                    update_priority_flags();
-                    int assigned = assign_priority_tickets_to(username);
-                    pthread_mutex_unlock(&g_shm->mutex);
-                    if (assigned > 0) {
-                        char tmsg[128];
-                        snprintf(tmsg, sizeof(tmsg), "Assigné %d ticket(s) PRIORITY à vous.\n", assigned);
-                        sendall(sock, tmsg);
-                    } else {
-                        sendall(sock, "Aucun ticket prioritaire à vous assigner maintenant.\n");
-                    }
-                }
-            } else {
-                sendall(sock, "Usage IDENT <username> <role:user|tech>\n");
-            }
-            continue;
-        }
+static void run_bench(const char *name) {
+    g_cfg.shm_path = BENCH_SHM_FILE;
+    g_cfg.wal_path = NULL;
+    unlink(BENCH_SHM_FILE);
+    store_open();
 
-        // --- Commandes utilisateur ---
-        if (strncmp(buf, "sendTicket ", 11) == 0) {
-            if (username[0]==0) { sendall(sock, "Identifiez-vous d'abord (IDENT ...)\n"); continue; }
+    if (strcmp(name, "locks") == 0) {
+        bench_locks();
+    } else if (strcmp(name, "list") == 0) {
+        bench_list();
+    } else {
+        fprintf(stderr, "Banc d'essai inconnu : %s (disponibles : locks, list)\n", name);
+        unlink(BENCH_SHM_FILE);
+        exit(EXIT_FAILURE);
+    }
+    unlink(BENCH_SHM_FILE);
+}
 
-            // Création d’un ticket
-            if (strncmp(buf+11, "-new", 4) == 0) {
-                char title[MAX_TITLE]="", desc[MAX_DESC]="";
+/* -------------------
+ * Mode multi-processus (--workers N) : le processus de départ ouvre le stockage (reprise
+ * comprise), puis devient un superviseur sans thread qui forke N workers. Chacun écoute
+ * le port avec SO_REUSEPORT (le noyau répartit les connexions) et sert ses clients sur
+ * le fichier mappé commun. Un worker mort est relancé ; ses verrous sont repris par les
+ * autres processus grâce aux mutex robustes.
+ * ------------------- */
 
-                // Extraction naïve entre guillemets
-                char *s = strchr(buf+11, '"');
-                if (!s) { sendall(sock, "Usage: sendTicket -new \"title\" \"description\"\n"); continue; }
-                s++;
+static volatile sig_atomic_t g_supervisor_stop = 0;
 
-                char *e = strchr(s, '"');
-                if (!e) { sendall(sock, "Guillemet de fermeture manquante pour le titre\n"); continue; }
-                size_t l = e - s; 
+static void supervisor_on_signal(int sig) {
+    (void)sig;
+    g_supervisor_stop = 1;
+}
 
-                if (l >= sizeof(title)) 
-                    l = sizeof(title)-1;
+// Retourne 0 dans le worker créé, son pid dans le superviseur
+static pid_t worker_spawn(void) {
+    pid_t parent = getpid();
 
-                // Recup le titre
-                strncpy(title, s, l); 
-                title[l]=0;
+    fflush(stdout); // Sinon le worker réécrirait ce que le superviseur n'a pas encore vidé
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0)
+        perror_exit("Erreur lors de la création d'un worker");
+    if (pid > 0) return pid;
 
-                char *s2 = strchr(e+1, '"');
-                if (!s2) { sendall(sock, "Guillemet d'ouverture manquante pour la description\n"); continue; }
-                s2++;
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    // Le worker s'arrête avec son superviseur (même tué par SIGKILL)
+    if (prctl(PR_SET_PDEATHSIG, SIGTERM) == -1 || getppid() != parent)
+        _exit(EXIT_FAILURE);
+    return 0;
+}
 
-                char *e2 = strchr(s2, '"');
-                if (!e2) { sendall(sock, "Guillemet de fermeture manquante pour la description\n"); continue; }
+// Lance n workers et les surveille. Ne revient que dans un worker, avec son numéro
+// (0 à n-1, conservé quand il est relancé) ; le superviseur se termine sur SIGTERM ou
+// SIGINT en arrêtant les workers, ou si un worker échoue dès son démarrage.
+// Appelant : seul thread du processus (fork)
+static int supervisor_run(int n) {
+    pid_t pids[MAX_PROCESSES];
+    time_t started[MAX_PROCESSES];
+    struct sigaction sa;
 
-                size_t l2 = e2 - s2; 
-                if (l2 >= sizeof(desc)) 
-                    l2 = sizeof(desc)-1;
-                
-                // Recup la description
-                strncpy(desc, s2, l2); desc[l2]=0;
+    // Sans SA_RESTART : le signal interrompt waitpid
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = supervisor_on_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
 
-                pthread_mutex_lock(&g_shm->mutex);
-                uint32_t id;
-                insert_ticket(username, title, desc, &id);
-                pthread_mutex_unlock(&g_shm->mutex);
+    for (int i = 0; i < n; i++) {
+        if ((pids[i] = worker_spawn()) == 0) return i;
+        started[i] = time(NULL);
+    }
+    printf("Superviseur (pid %d) : %d worker(s) sur le port %d\n", (int)getpid(), n, SERVER_PORT);
 
-                char out[128];
-                snprintf(out, sizeof(out), "Ticket créé avec ID %u\n", id);
-                sendall(sock, out);
-            }
-            // Liste des tickets
-            else if (strncmp(buf+11, "-l", 2) == 0) {
-                char out[4096];
-                pthread_mutex_lock(&g_shm->mutex);
-                list_tickets_for_owner(username, out, sizeof(out));
-                pthread_mutex_unlock(&g_shm->mutex);
-                sendall(sock, out);
-            } else {
-                sendall(sock, "Usage: sendTicket -new \"title\" \"description\" OR sendTicket -l\n");
-            }
-            continue;
+    int failed = 0;
+    while (!g_supervisor_stop) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            perror_exit("Erreur lors de l'attente des workers");
         }
-        // --- Commande EXIT ---
-        if (strcmp(buf, "exit") == 0) {
-            if (username[0] == 0) {
-                sendall(sock, "Vous devez être identifié avant de quitter.\n");
-                continue;
-            }
+        int i = 0;
+        while (i < n && pids[i] != pid) i++;
+        if (i == n) continue;
 
-            if (!is_technician) {
-                
-                sendall(sock, "Merci de donner votre avis avant de quitter.\n");
-                
-                int n1 = 0;
-                int n2 = 0;
-                int n3 = 0;
-                ssize_t rep;
-                
-                while (n1 == 0){
-                    sendall(sock, "Notez la réactivité du service (💩1-5🌟) : ");
-                    rep = recv(sock, buf, sizeof(buf)-1, 0);
-                    buf[rep] = '\0';
-                    n1 = atoi(buf);
-                }
+        pids[i] = 0;
+        if (WIFSIGNALED(status))
+            fprintf(stderr, "Worker %d (pid %d) tué par le signal %d\n", i, (int)pid, WTERMSIG(status));
+        else
+            fprintf(stderr, "Worker %d (pid %d) terminé avec le code %d\n", i, (int)pid, WEXITSTATUS(status));
 
-                while (n2 == 0){
-                    sendall(sock, "Notez la compétence du technicien (💩1-5🌟) : ");
-                    rep = recv(sock, buf, sizeof(buf)-1, 0);
-                    buf[rep] = '\0';
-                    n2 = atoi(buf);
-                }
+        // Un worker qui échoue dès son démarrage (port occupé, ...) échouerait encore
+        int early = time(NULL) - started[i] < WORKER_MIN_UPTIME;
+        if (early && WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS) {
+            failed = 1;
+            break;
+        }
+        if (early) sleep(1); // Pas de relance en boucle d'un worker qui plante aussitôt
+        if (g_supervisor_stop) break;
+        if ((pids[i] = worker_spawn()) == 0) return i;
+        started[i] = time(NULL);
+        printf("Worker %d relancé (pid %d)\n", i, (int)pids[i]);
+    }
 
-                while (n3 == 0){
-                    sendall(sock, "Notez votre satisfaction globale (💩1-5🌟) : ");
-                    rep = recv(sock, buf, sizeof(buf)-1, 0);
-                    buf[rep] = '\0';
-                    n3 = atoi(buf);
-                }
+    for (int i = 0; i < n; i++)
+        if (pids[i] > 0) kill(pids[i], SIGTERM);
+    while (wait(NULL) > 0 || errno == EINTR)
+        ;
+    printf("Superviseur arrêté\n");
+    exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
 
-                pthread_mutex_lock(&g_shm->mutex);
-                add_feedback(username, n1, n2, n3);
-                pthread_mutex_unlock(&g_shm->mutex);
+/* -------------------
+ * Fonction principale du serveur
+ * ------------------- */
 
-                sendall(sock, "Merci pour votre retour ! Au revoir.\n");
-            } else {
-                sendall(sock, "Déconnexion du technicien.\n");
-            }
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [--mode epoll|threads] [--threads N] [--no-pin] [--global-lock]\n"
+        "          [--feedback-capacity N] [--wal CHEMIN | --no-wal] [--snapshot CHEMIN]\n"
+        "          [--checkpoint-interval S] [--stats-file CHEMIN] [--stats-interval S]\n"
+        "          [--workers N] [--audit CHEMIN] [--audit-max-size MIO]\n"
+        "          [--tech-capacity N] [--dispatch-open] [--archive CHEMIN]\n"
+        "          [--archive-after S] [--no-list-cache] [--bench NOM]\n"
+        "  --mode epoll     boucle epoll + pool de workers (défaut)\n"
+        "  --mode threads   un thread par client (mode historique, pour comparaison)\n"
+        "  --threads N      nombre de workers epoll (défaut : un par coeur)\n"
+        "  --no-pin         ne pas épingler les workers sur les coeurs\n"
+        "  --global-lock    toutes les commandes sous un seul verrou (pour comparaison)\n"
+        "  --feedback-capacity N  nombre d'avis conservés (défaut : %d)\n"
+        "  --wal CHEMIN     préfixe des segments du journal (défaut : %s)\n"
+        "  --no-wal         pas de journal : l'état n'existe que dans le fichier mappé\n"
+        "  --snapshot CHEMIN  fichier du point de reprise (défaut : %s)\n"
+        "  --checkpoint-interval S  secondes max entre deux points de reprise (défaut : %d)\n"
+        "  --stats-file CHEMIN  réécrit périodiquement le rapport STATS dans ce fichier\n"
+        "  --stats-interval S  secondes entre deux rapports (défaut : %d)\n"
+        "  --workers N      N processus serveur sur le même port et le même stockage,\n"
+        "                   relancés par un superviseur s'ils meurent\n"
+        "  --audit CHEMIN   journal d'audit binaire (CHEMIN.<processus>.<numéro>, lu par auditdump)\n"
+        "  --audit-max-size MIO  taille d'un fichier d'audit avant le suivant (défaut : %d)\n"
+        "  --tech-capacity N  tickets en cours par technicien, sauf commande capacity (défaut : %d)\n"
+        "  --dispatch-open  la répartition assigne aussi les tickets OPEN aux techniciens libres\n"
+        "  --archive CHEMIN  préfixe des segments d'archive (défaut : %s)\n"
+        "  --archive-after S  archive les tickets CLOSED créés depuis plus de S secondes\n"
+        "  --no-list-cache  met en forme chaque ticket listé à chaque fois (pour comparaison)\n"
+        "  --bench locks    mesure la contention (verrou global contre verrous fins), puis quitte\n"
+        "  --bench list     mesure les listings avec et sans le cache des tickets mis en forme\n",
+        prog, FEEDBACK_DEFAULT_CAPACITY, WAL_FILE, SNAPSHOT_FILE, CHECKPOINT_INTERVAL, STATS_INTERVAL,
+        AUDIT_MAX_SIZE, TECH_CAPACITY, ARCHIVE_FILE);
+}
 
-            break; // quitte la boucle du client
-        }
-
-
-        // --- Commandes technicien ---
-        if (is_technician) {
-            // Liste les tickets visibles
-            if (strncmp(buf, "list", 4) == 0) {
-                char out[4096];
-                out[0]=0;
-                pthread_mutex_lock(&g_shm->mutex);
-                for (int i=0;i<MAX_TICKETS;i++){
-                    ticket_t *t = &g_shm->tickets[i];
-                    if (t->id != 0) {
-                        // Affiche si non assigné ou assigné à ce tech
-                        if (t->technician[0] == '\0' || strcmp(t->technician, username) == 0) {
-                            char st[16];
-                            switch(t->state){
-                                case OPEN: strcpy(st,"OPEN"); break;
-                                case IN_PROGRESS: strcpy(st,"IN_PROGRESS"); break;
-                                case CLOSED: strcpy(st,"CLOSED"); break;
-                                case PRIORITY: strcpy(st,"PRIORITY"); break;
-                            }
-                            char timebuf[64];
-                            struct tm tm;
-                            localtime_r(&t->created, &tm);
-                            strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", &tm);
-                            snprintf(out+strlen(out), sizeof(out)-strlen(out),
-                                "ID:%u | %s | owner:%s | tech:%s | created:%s\nTitle: %s\nDesc: %s\n\n",
-                                t->id, st, t->owner,
-                                (t->technician[0]?t->technician:"-"),
-                                timebuf, t->title, t->desc);
-                        }
-                    }
-                }
-                pthread_mutex_unlock(&g_shm->mutex);
-                if (out[0]==0) sendall(sock, "Aucun ticket à afficher.\n");
-                else sendall(sock, out);
-                continue;
-            }
+static void parse_args(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"mode",    required_argument, NULL, 'm'},
+        {"threads", required_argument, NULL, 't'},
+        {"no-pin",  no_argument,       NULL, 'P'},
+        {"global-lock", no_argument,   NULL, 'G'},
+        {"bench",   required_argument, NULL, 'B'},
+        {"feedback-capacity", required_argument, NULL, 'F'},
+        {"wal",     required_argument, NULL, 'W'},
+        {"no-wal",  no_argument,       NULL, 'N'},
+        {"snapshot", required_argument, NULL, 'S'},
+        {"checkpoint-interval", required_argument, NULL, 'C'},
+        {"stats-file", required_argument, NULL, 'D'},
+        {"stats-interval", required_argument, NULL, 'I'},
+        {"workers", required_argument, NULL, 'w'},
+        {"audit",   required_argument, NULL, 'A'},
+        {"audit-max-size", required_argument, NULL, 'M'},
+        {"tech-capacity", required_argument, NULL, 'K'},
+        {"dispatch-open", no_argument, NULL, 'O'},
+        {"archive", required_argument, NULL, 'R'},
+        {"archive-after", required_argument, NULL, 'X'},
+        {"no-list-cache", no_argument, NULL, 'L'},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int c;
 
-            // Prendre un ticket
-            if (strncmp(buf, "take ", 5) == 0) {
-                uint32_t id = (uint32_t)strtoul(buf+5, NULL, 10);
-                pthread_mutex_lock(&g_shm->mutex);
-                ticket_t *t = find_ticket_by_id(id);
-                if (!t) {
-                    sendall(sock, "Ticket introuvable.\n");
-                } else {
-                    if (t->state == CLOSED) sendall(sock, "Ticket déjà clos.\n");
-                    else {
-                        //printf("%d\n",assigned_count);
-                        int assigned_count = count_assigned_to_technician(username);
-                        if (assigned_count >= 5) {
-                            sendall(sock, "Capacité maximale atteinte (5 tickets).\n");
-                        } else {
-                            strncpy(t->technician, username, MAX_USER-1);
-                            t->state = IN_PROGRESS;
-                            sendall(sock, "Ticket pris en charge.\n");
-                        }
-                    }
+    while ((c = getopt_long(argc, argv, "m:t:h", opts, NULL)) != -1) {
+        switch (c) {
+            case 'm':
+                if (strcmp(optarg, "epoll") == 0) g_cfg.mode = MODE_EPOLL;
+                else if (strcmp(optarg, "threads") == 0) g_cfg.mode = MODE_THREADS;
+                else { usage(argv[0]); exit(EXIT_FAILURE); }
+                break;
+            case 't':
+                g_cfg.workers = atoi(optarg);
+                if (g_cfg.workers <= 0 || g_cfg.workers > MAX_WORKERS) {
+                    fprintf(stderr, "Nombre de workers invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
                 }
-                pthread_mutex_unlock(&g_shm->mutex);
-                continue;
+                break;
+            case 'P':
+                g_cfg.pin_workers = 0;
+                break;
+            case 'G':
+                g_cfg.global_lock = 1;
+                break;
+            case 'B':
+                g_cfg.bench = optarg;
+                break;
+            case 'F': {
+                long cap = strtol(optarg, NULL, 10);
+                if (cap <= 0 || cap > (1L << 24)) {
+                    fprintf(stderr, "Capacité d'avis invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                g_cfg.feedback_capacity = (uint32_t)cap;
+                break;
             }
-
-            // Fermer un ticket
-            if (strncmp(buf, "close ", 6) == 0) {
-                uint32_t id = (uint32_t)strtoul(buf+6, NULL, 10);
-                pthread_mutex_lock(&g_shm->mutex);
-                ticket_t *t = find_ticket_by_id(id);
-                if (!t) {
-                    sendall(sock, "Ticket introuvable.\n");
-                } else {
-                    if (strcmp(t->technician, username)!=0) {
-                        sendall(sock, "Vous n'êtes pas assigné à ce ticket.\n");
-                    } else {
-                        t->state = CLOSED;
-                        sendall(sock, "Ticket clôturé.\n");
-                    }
+            case 'W':
+                g_cfg.wal_path = optarg;
+                break;
+            case 'N':
+                g_cfg.wal_path = NULL;
+                break;
+            case 'S':
+                g_cfg.snapshot_path = optarg;
+                break;
+            case 'C':
+                g_cfg.checkpoint_interval = atoi(optarg);
+                if (g_cfg.checkpoint_interval <= 0) {
+                    fprintf(stderr, "Intervalle de points de reprise invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
                 }
-                pthread_mutex_unlock(&g_shm->mutex);
-                continue;
+                break;
+            case 'D':
+                g_cfg.stats_path = optarg;
+                break;
+            case 'I':
+                g_cfg.stats_interval = atoi(optarg);
+                if (g_cfg.stats_interval <= 0) {
+                    fprintf(stderr, "Intervalle des statistiques invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'w':
+                g_cfg.processes = atoi(optarg);
+                if (g_cfg.processes <= 0 || g_cfg.processes > MAX_PROCESSES) {
+                    fprintf(stderr, "Nombre de processus invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'A':
+                g_cfg.audit_path = optarg;
+                break;
+            case 'M': {
+                long mb = strtol(optarg, NULL, 10);
+                if (mb <= 0 || mb > 65536) {
+                    fprintf(stderr, "Taille de fichier d'audit invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                g_cfg.audit_max_mb = (uint32_t)mb;
+                break;
             }
-            if (strcmp(buf, "showFeedback") == 0) {
-                char out[2048];
-                out[0] = 0;
-                pthread_mutex_lock(&g_shm->mutex);
-                for (int i = 0; i < MAX_FEEDBACK; i++) {
-                    feedback_t *f = &g_shm->feedbacks[i];
-                    //printf("%s\n",f->username);
-                    if (f->username[0] != '\0') {
-                        snprintf(out + strlen(out), sizeof(out) - strlen(out),
-                            "Client: %s | Réactivité:%d | Compétence:%d | Satisfaction:%d\n",
-                            f->username, f->note_reactivite, f->note_competence, f->note_satisfaction);
-                    }
+            case 'K': {
+                long cap = strtol(optarg, NULL, 10);
+                if (cap <= 0 || cap > TECH_CAPACITY_MAX) {
+                    fprintf(stderr, "Capacité de technicien invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
                 }
-                pthread_mutex_unlock(&g_shm->mutex);
-                if (out[0] == 0)
-                    sendall(sock, "Aucun avis enregistré.\n");
-                else
-                    sendall(sock, out);
-                continue;
+                g_cfg.tech_capacity = (uint32_t)cap;
+                break;
             }
+            case 'O':
+                g_cfg.dispatch_open = 1;
+                break;
+            case 'R':
+                g_cfg.archive_path = optarg;
+                break;
+            case 'X':
+                g_cfg.archive_after = atoi(optarg);
+                if (g_cfg.archive_after <= 0) {
+                    fprintf(stderr, "Délai d'archivage invalide : %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'L':
+                g_cfg.list_cache = 0;
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
         }
+    }
+}
 
-        // Aide
-        if (strcmp(buf, "help") == 0) {
-            sendall(sock,
-                "Commandes:\n"
-                "IDENT <username> <role:user|tech>\n"
-                "sendTicket -new \"title\" \"description\"\n"
-                "sendTicket -l\n"
-                "list (technicien pour voir ses tickets)\n"
-                "take <id> (technicien)\n"
-                "close <id> (technicien)\n"
-                "showFeedback (technicien)\n"
-                "exit\n"
-            );
-            continue;
-        }
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
 
-        sendall(sock, "Commande inconnue. 'help' pour l'aide.\n");
+    if (g_cfg.bench) {
+        run_bench(g_cfg.bench);
+        return 0;
     }
 
-    close(sock); // Ferme la connexion client
-    return NULL;
-}
+    store_open(); // Crée et mappe la mémoire partagée, reprise depuis le disque
 
-/* -------------------
- * Fonction principale du serveur
- * ------------------- */
+    // En mode multi-processus, la suite s'exécute dans chaque worker ; le worker 0 se
+    // charge en plus des points de reprise, de l'archivage et du vidage des statistiques
+    int worker = g_cfg.processes ? supervisor_run(g_cfg.processes) : 0;
+    // Worker relancé : les techniciens du processus mort ne sont plus candidats à la répartition
+    index_lock();
+    tech_rebuild();
+    index_unlock();
+    stats_attach(); // Le thread principal accepte les connexions
+    if (g_cfg.audit_path)
+        audit_start(worker);
+
+    if (g_cfg.stats_path && worker == 0) {
+        pthread_t st;
+        if (pthread_create(&st, NULL, stats_thread, NULL) != 0)
+            perror_exit("Erreur lors de la création du thread des statistiques");
+        pthread_detach(st);
+    }
+
+    if (g_cfg.wal_path && worker == 0) {
+        pthread_t ckpt;
+        if (pthread_create(&ckpt, NULL, checkpoint_thread, NULL) != 0)
+            perror_exit("Erreur lors de la création du thread des points de reprise");
+        pthread_detach(ckpt);
+    }
 
-int main(void) {
-    shm_open_map(); // Crée et mappe la mémoire partagée
+    if (g_cfg.archive_after > 0 && worker == 0) {
+        pthread_t arch;
+        if (pthread_create(&arch, NULL, archive_thread, NULL) != 0)
+            perror_exit("Erreur lors de la création du thread d'archivage");
+        pthread_detach(arch);
+    }
 
     int listenfd;
     struct sockaddr_in addr;
@@ -642,6 +6272,9 @@ int main(void) {
 
     if (setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))==-1) // Réutilisation d’adresse
         perror_exit("Echec de setsockopt(SO_REUSEADDR)");
+    // Tous les workers écoutent le même port, le noyau leur répartit les connexions
+    if (g_cfg.processes && setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == -1)
+        perror_exit("Echec de setsockopt(SO_REUSEPORT)");
 
     memset(&addr,0,sizeof(addr));
     addr.sin_family = AF_INET;
@@ -653,7 +6286,19 @@ int main(void) {
     if (listen(listenfd, BACKLOG) == -1) 
         perror_exit("Echec de listen");
 
-    printf("Serveur de ticketing démarré sur 127.0.0.1:%d\n", SERVER_PORT);
+    pthread_t escalator;
+    if (pthread_create(&escalator, NULL, escalator_thread, NULL) != 0)
+        perror_exit("Erreur lors de la création du thread d'escalade");
+    pthread_detach(escalator);
+
+    if (g_cfg.mode == MODE_EPOLL)
+        reactors_start();
+
+    printf("Serveur de ticketing démarré sur 127.0.0.1:%d (mode %s",
+        SERVER_PORT, g_cfg.mode == MODE_EPOLL ? "epoll" : "threads");
+    if (g_cfg.mode == MODE_EPOLL) printf(", %d worker(s)", g_nreactors);
+    if (g_cfg.processes) printf(", processus %d/%d, pid %d", worker + 1, g_cfg.processes, (int)getpid());
+    printf(")\n");
 
     // --- Boucle principale d’acceptation des clients ---
     while (1) {
@@ -668,14 +6313,28 @@ int main(void) {
             continue;
         }
 
-        client_thread_arg_t *arg;
-        arg = malloc(sizeof(*arg));
-        arg->sock = client_descriptor;
-        pthread_t tid;
-        pthread_create(&tid, NULL, client_thread, arg); // Crée un thread par client
-        pthread_detach(tid); // Détache le thread (pas besoin de join)
+        session_t *s = session_new(client_descriptor);
+        if (!s) {
+            close(client_descriptor);
+            continue;
+        }
+
+        // Message d’accueil
+        sendall(s, "Bienvenue sur le serveur de ticketing. \nUsage: IDENT <username> <role:user|tech>\n");
+
+        if (g_cfg.mode == MODE_EPOLL) {
+            reactors_dispatch(s);
+        } else {
+            pthread_t tid;
+            if (pthread_create(&tid, NULL, client_thread, s) != 0) { // Crée un thread par client
+                close(client_descriptor);
+                session_free(s);
+                continue;
+            }
+            pthread_detach(tid); // Détache le thread (pas besoin de join)
+        }
     }
 
     close(listenfd);
     return 0;
-}
\ No newline at end of file
+}